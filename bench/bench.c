@@ -0,0 +1,1290 @@
+#include "cub3d.h"
+#include <time.h>
+
+// Frame benchmark, built apart from the game and without GLFW. It has its
+// own main, so it lives out of the way of cc *.c; from the repository root:
+//   cc -O2 -I. bench/bench.c caster.c collide.c dda.c grid.c headless.c player.c pool.c
+//      raster.c render.c sprite.c surface.c texture.c trig.c libmlx42_linux.a -lm -lpthread -o bench/bench
+// ./bench replays one scripted camera path through render_frame (casting,
+// first-person view and ray fan) on each reference map, offscreen, and writes
+// one line of key=value results per map to bench_output.txt. Maps and path
+// are generated from fixed seeds, so the checksum of every hit must not
+// change between runs or thread counts, only when casting results really
+// change. Walls, floor and ceiling are textured, 512x512 so far surfaces can
+// miss cache; run with CUB3D_MIPMAP=0 to time the view sampling full-size
+// textures throughout.
+// ./bench skip compares casting with block skipping off and on (CUB3D_SKIP)
+// on open arenas; the hits must match.
+// ./bench sprites times frames of an arena with and without BENCH_SPRITES
+// sprites in view; the difference is what the sprites cost.
+// ./bench turn turns on the spot at the start of the camera path of each
+// reference map, casting with the ray ring (only the columns turned into
+// view are cast) and without it (CUB3D_RING=0); the hits must match. It
+// also turns past thin pillars so far out that they fall between rays.
+// ./bench temporal walks down long corridors at the player's speed,
+// casting with and without reusing last frame's hits (CUB3D_TEMPORAL); the
+// hits must match. It reports how many columns were reused.
+// ./bench accuracy casts BENCH_ACCURACY_RAYS random rays on each reference
+// map with the DDA as built (double or, with -DCUB3D_DDA_FIXED, fixed point)
+// and checks the hit cell, side and distance of each against a plain cell
+// by cell DDA in doubles; every hit cell and side must match and every
+// distance be within BENCH_ACCURACY_BOUND.
+// ./bench batch casts the same random rays, each from its own origin,
+// through cast_ray_batch and one by one, and checks that the batch hits
+// (cell, side, distance, wall and texture u) agree.
+// Each mode that checks its results (skip, turn, temporal, accuracy and
+// batch) exits with status 1 when any map fails the check.
+// ./bench trig times sin and cos from libm against the binary angle tables
+// and gives the tables' worst error, at the angles they hold and at any
+// angle once rounded to them.
+// ./bench ray-setup times working out every column's ray direction for a
+// frame at 1920 and 3840 columns, the old way (angle per column through
+// normalize_angle, cos and sin) and from the camera plane, as the caster
+// does it now.
+// ./bench bodies moves BENCH_BODIES boxes at up to three cells per tick
+// through a pillar field, once with swept moves (collide_move, sliding on
+// along walls) and once substepping box tests a body size apart, and counts
+// the substepped moves that cut through a wall anyway.
+// ./bench collide checks BENCH_COLLIDE_MOVES random moves per map against
+// brute force: collide_move must hit exactly when the box comes to overlap
+// some wall cell by more than COLLIDE_EPSILON, and stop it where it first
+// touches that cell. collide_box and collide_point are checked the same way
+// at each start. Coordinates are whole hundredths of a pixel, so boxes often
+// end a move flush against a wall. Exits with status 1 on any mismatch.
+
+#define BENCH_OUTPUT "bench_output.txt"
+#define BENCH_WIDTH 1920
+#define BENCH_HEIGHT 1080
+#define BENCH_PATH_FRAMES 240
+#define BENCH_WARMUP_FRAMES 16
+#define BENCH_COLUMNS 1920
+#define BENCH_FRAMES 64
+#define BENCH_PILLAR_SPACING 48
+#define BENCH_TEXTURE_SIZE 512
+#define BENCH_SPRITES 1000
+#define BENCH_SPRITE_FRAMES 64
+#define BENCH_TURN_STEP 0.04
+#define BENCH_PILLAR_DISTANCE 2000
+#define BENCH_WALK_STEP 2
+#define BENCH_HALL_LENGTH 1024
+#define BENCH_BODIES 4096
+#define BENCH_BODY_SIZE 8
+#define BENCH_BODY_TICKS 256
+#define BENCH_COLLIDE_MOVES (1 << 20)
+#define BENCH_ACCURACY_RAYS (1 << 20)
+#define BENCH_ACCURACY_CHUNK 4096
+// Largest distance error, in pixels, bench accuracy accepts
+#define BENCH_ACCURACY_BOUND 1e-3
+#define BENCH_TRIG_ANGLES 4096
+#define BENCH_TRIG_ROUNDS 1024
+#define BENCH_SETUP_FRAMES 1024
+#define BENCH_SETUP_MAX_COLUMNS 3840
+
+#ifdef CUB3D_DDA_FIXED
+# define BENCH_KERNEL "fixed"
+#else
+# define BENCH_KERNEL "double"
+#endif
+
+// Camera keyframe: position as a fraction of the map size, angle in degrees
+typedef struct s_keyframe
+{
+    double x;
+    double y;
+    double angle;
+} t_keyframe;
+
+static const t_keyframe g_path[] = {
+    {0.50, 0.50, 0},
+    {0.70, 0.38, 60},
+    {0.78, 0.70, 150},
+    {0.45, 0.82, 220},
+    {0.22, 0.58, 300},
+    {0.33, 0.28, 400},
+    {0.50, 0.50, 360 + 360},
+};
+
+#define BENCH_KEYFRAMES (int)(sizeof(g_path) / sizeof(g_path[0]))
+
+typedef struct s_bench_map
+{
+    const char *name;
+    int (*make)(t_grid *grid);
+} t_bench_map;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// xorshift32: the same sequence on every platform, unlike rand()
+static uint32_t bench_rand(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static char *cell_at(t_grid *grid, int x, int y)
+{
+    return grid->cells + (size_t)y * grid->stride + x;
+}
+
+// size x size open cells with a 2x2 pillar on every spacing-th cell, offset
+// so the camera path around the centre stays clear
+static int make_arena(t_grid *grid, int size, int spacing)
+{
+    if (grid_alloc(grid, size, size, '0') != 0)
+        return -1;
+    grid_seal_border(grid);
+    for (int y = spacing / 2; y + 1 < size; y += spacing)
+        for (int x = spacing / 2; x + 1 < size; x += spacing) {
+            char *cell = cell_at(grid, x, y);
+            cell[0] = cell[1] = cell[grid->stride] = cell[grid->stride + 1] = '1';
+        }
+    return grid_build_solid(grid);
+}
+
+// Maze of one-cell corridors (a depth-first carve from a fixed seed) over
+// size x size cells; size should be odd.
+static int make_maze(t_grid *grid, int size)
+{
+    int rooms = size / 2;
+    int *stack = malloc((size_t)rooms * rooms * sizeof(int));
+    uint32_t seed = 0x9E3779B9;
+    int depth = 0;
+
+    if (!stack || grid_alloc(grid, size, size, '1') != 0) {
+        free(stack);
+        return -1;
+    }
+    // Room (rx, ry) is cell (2rx + 1, 2ry + 1); walls sit between rooms
+    *cell_at(grid, 1, 1) = '0';
+    stack[depth++] = 0;
+    while (depth > 0) {
+        int room = stack[depth - 1];
+        int rx = room % rooms;
+        int ry = room / rooms;
+        int next[4];
+        int n = 0;
+
+        if (rx > 0 && *cell_at(grid, 2 * rx - 1, 2 * ry + 1) == '1')
+            next[n++] = room - 1;
+        if (rx + 1 < rooms && *cell_at(grid, 2 * rx + 3, 2 * ry + 1) == '1')
+            next[n++] = room + 1;
+        if (ry > 0 && *cell_at(grid, 2 * rx + 1, 2 * ry - 1) == '1')
+            next[n++] = room - rooms;
+        if (ry + 1 < rooms && *cell_at(grid, 2 * rx + 1, 2 * ry + 3) == '1')
+            next[n++] = room + rooms;
+        if (n == 0) {
+            depth--;
+            continue;
+        }
+        int to = next[bench_rand(&seed) % n];
+        int tx = to % rooms;
+        int ty = to / rooms;
+
+        *cell_at(grid, rx + tx + 1, ry + ty + 1) = '0';
+        *cell_at(grid, 2 * tx + 1, 2 * ty + 1) = '0';
+        stack[depth++] = to;
+    }
+    free(stack);
+    return grid_build_solid(grid);
+}
+
+static int make_tiny(t_grid *grid)
+{
+    return make_arena(grid, 24, 8);
+}
+
+static int make_corridors(t_grid *grid)
+{
+    return make_maze(grid, 511);
+}
+
+static int make_open_arena(t_grid *grid)
+{
+    return make_arena(grid, 1024, BENCH_PILLAR_SPACING);
+}
+
+static int make_huge(t_grid *grid)
+{
+    return make_arena(grid, 10000, BENCH_PILLAR_SPACING);
+}
+
+static const t_bench_map g_maps[] = {
+    {"tiny", make_tiny},
+    {"corridors", make_corridors},
+    {"arena", make_open_arena},
+    {"huge", make_huge},
+};
+
+#define BENCH_MAPS (int)(sizeof(g_maps) / sizeof(g_maps[0]))
+
+static void path_at(double t, double *x, double *y, double *angle)
+{
+    double segment = t * (BENCH_KEYFRAMES - 1);
+    int k = segment >= BENCH_KEYFRAMES - 1 ? BENCH_KEYFRAMES - 2 : (int)segment;
+    double f = segment - k;
+    const t_keyframe *a = &g_path[k];
+    const t_keyframe *b = &g_path[k + 1];
+
+    *x = a->x + (b->x - a->x) * f;
+    *y = a->y + (b->y - a->y) * f;
+    *angle = a->angle + (b->angle - a->angle) * f;
+}
+
+// Opens a 3x3 cell band along the whole camera path, so the camera never
+// stands inside a wall whatever the map
+static int carve_path(t_grid *grid)
+{
+    for (int k = 0; k + 1 < BENCH_KEYFRAMES; k++) {
+        double dx = (g_path[k + 1].x - g_path[k].x) * grid->width;
+        double dy = (g_path[k + 1].y - g_path[k].y) * grid->height;
+        int steps = (int)(4 * (fabs(dx) + fabs(dy))) + 1;
+
+        for (int i = 0; i <= steps; i++) {
+            int cx = (int)(g_path[k].x * grid->width + dx * i / steps);
+            int cy = (int)(g_path[k].y * grid->height + dy * i / steps);
+
+            for (int y = cy - 1; y <= cy + 1; y++)
+                for (int x = cx - 1; x <= cx + 1; x++)
+                    if (x >= 0 && y >= 0 && x < grid->width && y < grid->height)
+                        *cell_at(grid, x, y) = '0';
+        }
+    }
+    return grid_build_solid(grid);
+}
+
+static int compare_times(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted times
+static double percentile(const double *sorted, int n, double p)
+{
+    int rank = (int)ceil(p * n);
+    return sorted[rank < 1 ? 0 : rank - 1];
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ p[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+// FNV-1a over the distance and side of every hit of the frame
+static uint64_t hash_hits(uint64_t hash, const t_caster *caster)
+{
+    for (int i = 0; i < caster->count; i++) {
+        hash = hash_bytes(hash, &caster->batch.dist[i], sizeof(double));
+        hash = hash_bytes(hash, &caster->batch.side[i], sizeof(int));
+    }
+    return hash;
+}
+
+// Brick textures, tinted per face, floor, ceiling and sprite, with a little
+// fixed noise so neighbouring texels differ like in real art
+static int make_textures(t_texture *surfaces)
+{
+    static uint8_t rgba[BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE * 4];
+    static const uint8_t tints[TEX_COUNT][3] = {
+        {170, 74, 60}, {150, 90, 70}, {160, 110, 80}, {130, 70, 50}, {100, 90, 80}, {120, 130, 140},
+        {220, 180, 60},
+    };
+    uint32_t seed = 0x2545F491;
+
+    for (int face = 0; face < TEX_COUNT; face++) {
+        for (int y = 0; y < BENCH_TEXTURE_SIZE; y++)
+            for (int x = 0; x < BENCH_TEXTURE_SIZE; x++) {
+                uint8_t *texel = rgba + (y * BENCH_TEXTURE_SIZE + x) * 4;
+                int mortar = y % 16 == 0 || (x + (y / 16 % 2) * 16) % 32 == 0;
+                int noise = bench_rand(&seed) % 24;
+
+                int dx = 2 * x - BENCH_TEXTURE_SIZE;
+                int dy = 2 * y - BENCH_TEXTURE_SIZE;
+
+                for (int i = 0; i < 3; i++)
+                    texel[i] = mortar ? 200 : tints[face][i] - noise;
+                // The sprite is a disc, transparent around it
+                texel[3] = face != TEX_SPRITE || dx * dx + dy * dy < BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE ? 0xFF : 0;
+            }
+        if (texture_from_rgba(&surfaces[face], rgba, BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Replays the camera path on one map and reports it to out and stdout
+static int run_path(const t_bench_map *map, t_player *player, FILE *out)
+{
+    double times[BENCH_PATH_FRAMES];
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    double total = 0;
+    t_grid *grid = &player->scene.grid;
+
+    if (map->make(grid) != 0 || carve_path(grid) != 0) {
+        fprintf(stderr, "Error\ncannot build map %s\n", map->name);
+        return -1;
+    }
+    raster_rect(player->direction_ray, 0, 0, BENCH_WIDTH, BENCH_HEIGHT, 0);
+    player->ray_dirty = rect_empty();
+    for (int frame = -BENCH_WARMUP_FRAMES; frame < BENCH_PATH_FRAMES; frame++) {
+        double x, y, angle;
+
+        path_at((frame < 0 ? 0 : frame) / (double)BENCH_PATH_FRAMES, &x, &y, &angle);
+        player->x_pos = x * grid->width * TILE_SIZE - player->size / 2.0;
+        player->y_pos = y * grid->height * TILE_SIZE - player->size / 2.0;
+        player->direction_angle = normalize_angle(deg_to_radian(angle));
+
+        t_pose pose = player_pose(player);
+        double start = now();
+        render_frame(player, &pose);
+        double elapsed = now() - start;
+
+        if (frame < 0)
+            continue;
+        times[frame] = elapsed;
+        total += elapsed;
+        hash = hash_hits(hash, &player->caster);
+    }
+    qsort(times, BENCH_PATH_FRAMES, sizeof(double), compare_times);
+
+    double rays = (double)BENCH_PATH_FRAMES * player->caster.count;
+    double pixels = (double)BENCH_PATH_FRAMES * BENCH_WIDTH * BENCH_HEIGHT;
+    char line[512];
+
+    snprintf(line, sizeof(line), "map=%s cells=%dx%d frames=%d threads=%d rays_per_frame=%d "
+             "p50_ms=%.4f p99_ms=%.4f max_ms=%.4f rays_per_sec=%.0f pixels_per_sec=%.0f "
+             "checksum=%016llx\n",
+             map->name, grid->width, grid->height, BENCH_PATH_FRAMES, pool_default_threads(),
+             player->caster.count, percentile(times, BENCH_PATH_FRAMES, 0.50) * 1e3,
+             percentile(times, BENCH_PATH_FRAMES, 0.99) * 1e3, times[BENCH_PATH_FRAMES - 1] * 1e3,
+             rays / total, pixels / total, (unsigned long long)hash);
+    fputs(line, stdout);
+    fputs(line, out);
+    grid_destroy(grid);
+    return 0;
+}
+
+static int run_suite(void)
+{
+    t_player player;
+    FILE *out = fopen(BENCH_OUTPUT, "w");
+    int status = 0;
+
+    memset(&player, 0, sizeof(t_player));
+    player.size = 6;
+    player.view = headless_image(BENCH_WIDTH, BENCH_HEIGHT);
+    player.direction_ray = headless_image(BENCH_WIDTH, BENCH_HEIGHT);
+    player.scene.ceiling_color = 0x6F9FDFFF;
+    player.scene.floor_color = 0x5A4632FF;
+    if (!out || !player.view || !player.direction_ray || make_textures(player.scene.surfaces) != 0
+        || caster_init(&player.caster, pool_default_threads()) != 0
+        || caster_reserve(&player.caster, BENCH_WIDTH, BENCH_HEIGHT) != 0) {
+        fprintf(stderr, "Error\ncannot set up the benchmark\n");
+        return 1;
+    }
+    for (int i = 0; i < BENCH_MAPS && status == 0; i++)
+        status = run_path(&g_maps[i], &player, out);
+    caster_destroy(&player.caster);
+    for (int i = 0; i < TEX_COUNT; i++)
+        texture_destroy(&player.scene.surfaces[i]);
+    headless_image_delete(player.view);
+    headless_image_delete(player.direction_ray);
+    fclose(out);
+    return status != 0;
+}
+
+// Casts BENCH_FRAMES frames along a circle around the arena centre, copying
+// every distance to out; returns the seconds per frame.
+static double run_frames(t_caster *caster, const t_grid *grid, double *out)
+{
+    double radius = grid->width * TILE_SIZE / 4.0;
+    double start = now();
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+        double t = 2 * PI * frame / BENCH_FRAMES;
+        t_camera camera;
+
+        camera_from_angle(&camera, t * 3, FOV * PI / 180);
+        caster_cast(caster, grid, grid->width * TILE_SIZE / 2.0 + radius * cos(t) + 0.5,
+                    grid->height * TILE_SIZE / 2.0 + radius * sin(t) + 0.5, &camera, BENCH_COLUMNS);
+        for (int i = 0; i < BENCH_COLUMNS; i++)
+            out[frame * BENCH_COLUMNS + i] = caster->batch.dist[i];
+    }
+    return (now() - start) / BENCH_FRAMES;
+}
+
+static int run_skip_compare(void)
+{
+    static const int sizes[] = {256, 1024, 4096};
+    size_t frame_size = (size_t)BENCH_FRAMES * BENCH_COLUMNS;
+    double *plain = malloc(frame_size * sizeof(double));
+    double *skip = malloc(frame_size * sizeof(double));
+    t_caster caster;
+    int status = 0;
+
+    if (!plain || !skip || caster_init(&caster, 1) != 0)
+        return 1;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        t_grid grid;
+
+        if (make_arena(&grid, sizes[i], BENCH_PILLAR_SPACING) != 0)
+            return 1;
+        setenv("CUB3D_SKIP", "0", 1);
+        caster.packet = dda_select_packet();
+        double plain_time = run_frames(&caster, &grid, plain);
+        setenv("CUB3D_SKIP", "1", 1);
+        caster.packet = dda_select_packet();
+        double skip_time = run_frames(&caster, &grid, skip);
+        int differ = memcmp(plain, skip, frame_size * sizeof(double)) != 0;
+
+        status |= differ;
+        printf("arena %4dx%-4d  plain %7.2f ms/frame  skip %7.2f ms/frame  %5.2fx  hits %s\n",
+               sizes[i], sizes[i], plain_time * 1e3, skip_time * 1e3, plain_time / skip_time,
+               differ ? "DIFFER" : "identical");
+        grid_destroy(&grid);
+    }
+    caster_destroy(&caster);
+    free(plain);
+    free(skip);
+    return status;
+}
+
+// Casts BENCH_FRAMES frames turning BENCH_TURN_STEP radians a frame (the
+// player's turn speed) from one spot, copying every distance to out and
+// adding up the columns cast to *cast; returns the seconds per frame. The
+// first frame, cast from scratch, is not timed.
+static double run_turn_frames(t_caster *caster, const t_grid *grid, double *out, long *cast)
+{
+    double x, y, angle;
+    double start = 0;
+
+    path_at(0, &x, &y, &angle);
+    for (int frame = -1; frame < BENCH_FRAMES; frame++) {
+        t_camera camera;
+
+        if (frame == 0)
+            start = now();
+        camera_from_angle(&camera, deg_to_radian(angle) + BENCH_TURN_STEP * (frame + 1), FOV * PI / 180);
+        caster_cast(caster, grid, x * grid->width * TILE_SIZE, y * grid->height * TILE_SIZE, &camera,
+                    BENCH_COLUMNS);
+        if (frame < 0)
+            continue;
+        *cast += caster->recast_count;
+        for (int i = 0; i < BENCH_COLUMNS; i++)
+            out[frame * BENCH_COLUMNS + i] = caster->batch.dist[i];
+    }
+    return (now() - start) / BENCH_FRAMES;
+}
+
+// Open arena with one-cell pillars BENCH_PILLAR_DISTANCE cells out from the
+// start of the camera path, one every 0.02 radians over the directions
+// ./bench turn sweeps. Rays that far out are more than a cell apart, so a
+// pillar can fall between two rays that both hit the wall behind it.
+static int make_far_pillars(t_grid *grid)
+{
+    int size = 4096;
+
+    if (grid_alloc(grid, size, size, '0') != 0)
+        return -1;
+    grid_seal_border(grid);
+    for (double angle = -1; angle < 4; angle += 0.02)
+        *cell_at(grid, (int)(size * g_path[0].x + BENCH_PILLAR_DISTANCE * cos(angle)),
+                 (int)(size * g_path[0].y + BENCH_PILLAR_DISTANCE * sin(angle))) = '1';
+    return grid_build_solid(grid);
+}
+
+static const t_bench_map g_far_pillars = {"far", make_far_pillars};
+
+// Turns on map with the ring and without it; returns 1 when the hits differ
+static int turn_compare(const t_bench_map *map, t_caster *with, t_caster *without, double *plain, double *ring)
+{
+    size_t frame_size = (size_t)BENCH_FRAMES * BENCH_COLUMNS;
+    t_grid grid;
+    long plain_cast = 0;
+    long ring_cast = 0;
+
+    if (map->make(&grid) != 0 || carve_path(&grid) != 0)
+        return 1;
+    double plain_time = run_turn_frames(without, &grid, plain, &plain_cast);
+    double ring_time = run_turn_frames(with, &grid, ring, &ring_cast);
+    int differ = memcmp(plain, ring, frame_size * sizeof(double)) != 0;
+
+    printf("map=%-9s plain %7.3f ms/frame  ring %7.3f ms/frame  %6.2fx  cast %4ld/%d columns/frame  hits %s\n",
+           map->name, plain_time * 1e3, ring_time * 1e3, plain_time / ring_time,
+           ring_cast / BENCH_FRAMES, BENCH_COLUMNS,
+           differ ? "DIFFER" : "identical");
+    grid_destroy(&grid);
+    return differ;
+}
+
+static int run_turn(void)
+{
+    size_t frame_size = (size_t)BENCH_FRAMES * BENCH_COLUMNS;
+    double *plain = malloc(frame_size * sizeof(double));
+    double *ring = malloc(frame_size * sizeof(double));
+    t_caster with;
+    t_caster without;
+    int status = 0;
+
+    setenv("CUB3D_RING", "0", 1);
+    if (!plain || !ring || caster_init(&without, pool_default_threads()) != 0)
+        return 1;
+    setenv("CUB3D_RING", "1", 1);
+    if (caster_init(&with, pool_default_threads()) != 0)
+        return 1;
+    for (int i = 0; i < BENCH_MAPS; i++)
+        status |= turn_compare(&g_maps[i], &with, &without, plain, ring);
+    status |= turn_compare(&g_far_pillars, &with, &without, plain, ring);
+    caster_destroy(&with);
+    caster_destroy(&without);
+    free(plain);
+    free(ring);
+    return status;
+}
+
+// Parallel corridors BENCH_HALL_LENGTH cells long and 4 wide, one wall
+// apart, with a doorway every 40 cells
+static int make_halls(t_grid *grid)
+{
+    if (grid_alloc(grid, BENCH_HALL_LENGTH, 64, '0') != 0)
+        return -1;
+    grid_seal_border(grid);
+    for (int y = 0; y < grid->height; y += 5)
+        for (int x = 0; x < grid->width; x++)
+            if (x % 40 != 20)
+                *cell_at(grid, x, y) = '1';
+    return grid_build_solid(grid);
+}
+
+// Casts BENCH_FRAMES frames walking BENCH_WALK_STEP pixels a frame along a
+// corridor, looking down it and swaying a little, copying every distance to
+// out and adding up the columns cast to *cast; returns the seconds per
+// frame. The first frame has nothing to reuse and is not timed.
+static double run_walk_frames(t_caster *caster, const t_grid *grid, int row, double *out, long *cast)
+{
+    double start = 0;
+
+    for (int frame = -1; frame < BENCH_FRAMES; frame++) {
+        double angle = 0.1 * sin(frame * 0.05);
+        t_camera camera;
+
+        if (frame == 0)
+            start = now();
+        camera_from_angle(&camera, angle, FOV * PI / 180);
+        caster_cast(caster, grid, (8 + (frame + 1) * (double)BENCH_WALK_STEP / TILE_SIZE) * TILE_SIZE,
+                    (row + 0.5) * TILE_SIZE + 8 * sin(frame * 0.03), &camera, BENCH_COLUMNS);
+        if (frame < 0)
+            continue;
+        *cast += caster->recast_count;
+        for (int i = 0; i < BENCH_COLUMNS; i++)
+            out[frame * BENCH_COLUMNS + i] = caster->batch.dist[i];
+    }
+    return (now() - start) / BENCH_FRAMES;
+}
+
+static int run_temporal(void)
+{
+    static const t_bench_map maps[] = {
+        {"halls", make_halls},
+        {"corridors", make_corridors},
+    };
+    size_t frame_size = (size_t)BENCH_FRAMES * BENCH_COLUMNS;
+    double *plain = malloc(frame_size * sizeof(double));
+    double *reused = malloc(frame_size * sizeof(double));
+    t_caster with;
+    t_caster without;
+    int status = 0;
+
+    setenv("CUB3D_TEMPORAL", "0", 1);
+    if (!plain || !reused || caster_init(&without, pool_default_threads()) != 0)
+        return 1;
+    setenv("CUB3D_TEMPORAL", "1", 1);
+    if (caster_init(&with, pool_default_threads()) != 0)
+        return 1;
+    for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); i++) {
+        t_grid grid;
+        long plain_cast = 0;
+        long cast = 0;
+        int row = 2;
+
+        if (maps[i].make(&grid) != 0)
+            return 1;
+        // Any row with a long open run will do on the maze
+        while (row < grid.height && grid_row_solid(&grid, row, 8, 8 + BENCH_FRAMES * BENCH_WALK_STEP / TILE_SIZE + 1))
+            row++;
+        double plain_time = run_walk_frames(&without, &grid, row, plain, &plain_cast);
+        double time = run_walk_frames(&with, &grid, row, reused, &cast);
+        int differ = memcmp(plain, reused, frame_size * sizeof(double)) != 0;
+
+        status |= differ;
+        printf("map=%-9s plain %7.3f ms/frame  temporal %7.3f ms/frame  %5.2fx  reused %5.1f%%  hits %s\n",
+               maps[i].name, plain_time * 1e3, time * 1e3, plain_time / time,
+               100.0 - 100.0 * cast / ((double)BENCH_FRAMES * BENCH_COLUMNS),
+               differ ? "DIFFER" : "identical");
+        grid_destroy(&grid);
+    }
+    caster_destroy(&with);
+    caster_destroy(&without);
+    free(plain);
+    free(reused);
+    return status;
+}
+
+// Cell by cell DDA in doubles, with no block skipping, as the reference for
+// run_accuracy. pos is in cells; returns the distance in pixels.
+static double reference_cast(const t_grid *grid, double pos_x, double pos_y, double dir_x,
+                             double dir_y, int *cell_x, int *cell_y, int *side)
+{
+    int step_x = dir_x < 0 ? -1 : 1;
+    int step_y = dir_y < 0 ? -1 : 1;
+    double delta_x = dir_x == 0 ? 1e30 : fabs(1 / dir_x);
+    double delta_y = dir_y == 0 ? 1e30 : fabs(1 / dir_y);
+    int map_x = (int)pos_x;
+    int map_y = (int)pos_y;
+    double side0_x = (dir_x < 0 ? pos_x - map_x : map_x + 1.0 - pos_x) * delta_x;
+    double side0_y = (dir_y < 0 ? pos_y - map_y : map_y + 1.0 - pos_y) * delta_y;
+    int n_x = 0;
+    int n_y = 0;
+
+    do {
+        if (side0_x + n_x * delta_x < side0_y + n_y * delta_y) {
+            n_x++;
+            map_x += step_x;
+            *side = 0;
+        } else {
+            n_y++;
+            map_y += step_y;
+            *side = 1;
+        }
+    } while (!grid_solid(grid, map_x, map_y));
+    *cell_x = map_x;
+    *cell_y = map_y;
+    return wall_distance(pos_x, pos_y, map_x, map_y, *side, dir_x, dir_y);
+}
+
+// Random rays from open cells, in every direction
+static void random_rays(const t_grid *grid, uint32_t *seed, double *x, double *y, double *dir_x, double *dir_y)
+{
+    for (int i = 0; i < BENCH_ACCURACY_CHUNK; i++) {
+        int cx, cy;
+
+        do {
+            cx = bench_rand(seed) % grid->width;
+            cy = bench_rand(seed) % grid->height;
+        } while (grid_solid(grid, cx, cy));
+        double angle = bench_rand(seed) / 4294967296.0 * 2 * PI;
+
+        x[i] = (cx + bench_rand(seed) / 4294967296.0) * TILE_SIZE;
+        y[i] = (cy + bench_rand(seed) / 4294967296.0) * TILE_SIZE;
+        dir_x[i] = cos(angle);
+        dir_y[i] = sin(angle);
+    }
+}
+
+static int run_accuracy(void)
+{
+    static double x[BENCH_ACCURACY_CHUNK], y[BENCH_ACCURACY_CHUNK];
+    static double dir_x[BENCH_ACCURACY_CHUNK], dir_y[BENCH_ACCURACY_CHUNK];
+    static double dist[BENCH_ACCURACY_CHUNK];
+    static int cell_x[BENCH_ACCURACY_CHUNK], cell_y[BENCH_ACCURACY_CHUNK], side[BENCH_ACCURACY_CHUNK];
+    int status = 0;
+
+    for (int i = 0; i < BENCH_MAPS; i++) {
+        t_grid grid;
+        uint32_t seed = 0x2545F491;
+        long mismatched = 0;
+        double max_error = 0;
+        double total_error = 0;
+        double time = 0;
+
+        if (g_maps[i].make(&grid) != 0)
+            return 1;
+        for (int done = 0; done < BENCH_ACCURACY_RAYS; done += BENCH_ACCURACY_CHUNK) {
+            random_rays(&grid, &seed, x, y, dir_x, dir_y);
+            double start = now();
+            for (int r = 0; r < BENCH_ACCURACY_CHUNK; r++)
+                dist[r] = cast_single_ray_cell(&grid, x[r], y[r], dir_x[r], dir_y[r],
+                                               &cell_x[r], &cell_y[r], &side[r]);
+            time += now() - start;
+            for (int r = 0; r < BENCH_ACCURACY_CHUNK; r++) {
+                int ref_x, ref_y, ref_side;
+                double ref = reference_cast(&grid, x[r] / TILE_SIZE, y[r] / TILE_SIZE, dir_x[r], dir_y[r],
+                                            &ref_x, &ref_y, &ref_side);
+
+                if (ref_x != cell_x[r] || ref_y != cell_y[r] || ref_side != side[r]) {
+                    mismatched++;
+                    continue;
+                }
+                double error = fabs(dist[r] - ref);
+                max_error = error > max_error ? error : max_error;
+                total_error += error;
+            }
+        }
+        printf("map=%-9s %s %6.1f ns/ray  hit cell differs %ld/%d  distance error max %.3g mean %.3g px\n",
+               g_maps[i].name, BENCH_KERNEL, time / BENCH_ACCURACY_RAYS * 1e9, mismatched,
+               BENCH_ACCURACY_RAYS, max_error, total_error / (BENCH_ACCURACY_RAYS - mismatched));
+        status |= mismatched > 0 || max_error > BENCH_ACCURACY_BOUND;
+        grid_destroy(&grid);
+    }
+    return status;
+}
+
+static int run_batch(void)
+{
+    static double x[BENCH_ACCURACY_CHUNK], y[BENCH_ACCURACY_CHUNK];
+    static double dir_x[BENCH_ACCURACY_CHUNK], dir_y[BENCH_ACCURACY_CHUNK];
+    t_ray_batch batch = {0};
+    int status = 0;
+
+    if (ray_batch_reserve(&batch, BENCH_ACCURACY_CHUNK) != 0)
+        return 1;
+    for (int i = 0; i < BENCH_MAPS; i++) {
+        t_grid grid;
+        uint32_t seed = 0x2545F491;
+        long differ = 0;
+        double time = 0;
+
+        if (g_maps[i].make(&grid) != 0)
+            return 1;
+        for (int done = 0; done < BENCH_ACCURACY_RAYS; done += BENCH_ACCURACY_CHUNK) {
+            random_rays(&grid, &seed, x, y, dir_x, dir_y);
+            double start = now();
+            cast_ray_batch(&grid, x, y, dir_x, dir_y, BENCH_ACCURACY_CHUNK, &batch);
+            time += now() - start;
+            for (int r = 0; r < BENCH_ACCURACY_CHUNK; r++) {
+                int cell_x, cell_y, side;
+
+                double dist = cast_single_ray_cell(&grid, x[r], y[r], dir_x[r], dir_y[r], &cell_x, &cell_y, &side);
+                double along = side ? x[r] + dir_x[r] * dist : y[r] + dir_y[r] * dist;
+                double u = along / TILE_SIZE - (side ? cell_x : cell_y);
+
+                if (dist != batch.dist[r] || cell_x != batch.cell_x[r] || cell_y != batch.cell_y[r]
+                    || side != batch.side[r] || batch.wall[r] != ray_wall(side, dir_x[r], dir_y[r])
+                    || !(batch.u[r] >= 0 && batch.u[r] < 1) || fabs(batch.u[r] - u) > 1e-6)
+                    differ++;
+            }
+        }
+        printf("map=%-9s batch %6.1f ns/ray  hits differ %ld/%d\n",
+               g_maps[i].name, time / BENCH_ACCURACY_RAYS * 1e9, differ, BENCH_ACCURACY_RAYS);
+        status |= differ > 0;
+        grid_destroy(&grid);
+    }
+    ray_batch_destroy(&batch);
+    return status;
+}
+
+static int run_trig(void)
+{
+    static double angles[BENCH_TRIG_ANGLES];
+    uint32_t seed = 0x6C8E9CF5;
+    double table_error = 0;
+    double rounded_error = 0;
+    double tan_error = 0;
+    double sum = 0;
+
+    for (int a = 0; a < ANGLE_UNITS; a++) {
+        double r = angle_to_radians(a);
+
+        table_error = fmax(table_error, fabs(bam_sin(a) - sin(r)));
+        table_error = fmax(table_error, fabs(bam_cos(a) - cos(r)));
+    }
+    // Whole turns either way, as angles come in before normalize_angle
+    for (int i = 0; i < BENCH_TRIG_ANGLES; i++)
+        angles[i] = (bench_rand(&seed) / 4294967296.0 - 0.5) * 8 * PI;
+    for (int i = 0; i < BENCH_TRIG_ANGLES; i++) {
+        t_angle a = angle_from_radians(angles[i]);
+        // Only tan of up to half the widest sensible field of view is used
+        double fov = angles[i] / 12;
+
+        rounded_error = fmax(rounded_error, fabs(bam_sin(a) - sin(angles[i])));
+        rounded_error = fmax(rounded_error, fabs(bam_cos(a) - cos(angles[i])));
+        tan_error = fmax(tan_error, fabs(bam_tan(angle_from_radians(fov)) - tan(fov)));
+    }
+
+    double start = now();
+    for (int round = 0; round < BENCH_TRIG_ROUNDS; round++)
+        for (int i = 0; i < BENCH_TRIG_ANGLES; i++)
+            sum += sin(angles[i]) + cos(angles[i]);
+    double libm_time = now() - start;
+    start = now();
+    for (int round = 0; round < BENCH_TRIG_ROUNDS; round++)
+        for (int i = 0; i < BENCH_TRIG_ANGLES; i++) {
+            t_angle a = angle_from_radians(angles[i]);
+
+            sum -= bam_sin(a) + bam_cos(a);
+        }
+    double table_time = now() - start;
+    double pairs = (double)BENCH_TRIG_ROUNDS * BENCH_TRIG_ANGLES;
+
+    printf("sin+cos  libm %6.2f ns  tables %6.2f ns  %5.2fx\n", libm_time / pairs * 1e9,
+           table_time / pairs * 1e9, libm_time / table_time);
+    printf("error  at table angles %.3g  rounding any angle %.3g  tan up to 60 deg %.3g  (sum %.3g)\n",
+           table_error, rounded_error, tan_error, sum);
+    return 0;
+}
+
+// Column directions for a view at angle: one angle per column, stepped
+// evenly across the field of view, then its cos and sin
+static void setup_from_angles(double angle, int columns, double *dir_x, double *dir_y)
+{
+    double fov = deg_to_radian(FOV);
+    double step = fov / columns;
+    double start = angle - fov / 2;
+
+    for (int i = 0; i < columns; i++) {
+        double ray_angle = normalize_angle(start + i * step);
+
+        dir_x[i] = cos(ray_angle);
+        dir_y[i] = sin(ray_angle);
+    }
+}
+
+// The same from the camera plane: one camera per frame, then a step along
+// the plane per column
+static void setup_from_plane(double angle, int columns, double *dir_x, double *dir_y)
+{
+    t_camera camera;
+
+    camera_from_angle(&camera, angle, deg_to_radian(FOV));
+    double ray0_x = camera.dir_x - camera.plane_x;
+    double ray0_y = camera.dir_y - camera.plane_y;
+    double step_x = 2 * camera.plane_x / columns;
+    double step_y = 2 * camera.plane_y / columns;
+
+    for (int i = 0; i < columns; i++) {
+        dir_x[i] = ray0_x + i * step_x;
+        dir_y[i] = ray0_y + i * step_y;
+    }
+}
+
+static double time_setup(void (*setup)(double, int, double *, double *), int columns, double *sum)
+{
+    static double dir_x[BENCH_SETUP_MAX_COLUMNS];
+    static double dir_y[BENCH_SETUP_MAX_COLUMNS];
+    double start = now();
+
+    for (int frame = 0; frame < BENCH_SETUP_FRAMES; frame++) {
+        setup(frame * BENCH_TURN_STEP, columns, dir_x, dir_y);
+        *sum += dir_x[frame % columns] + dir_y[columns - 1 - frame % columns];
+    }
+    return (now() - start) / BENCH_SETUP_FRAMES;
+}
+
+static int run_ray_setup(void)
+{
+    static const int columns[] = {1920, BENCH_SETUP_MAX_COLUMNS};
+    double sum = 0;
+
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+        double angles = time_setup(setup_from_angles, columns[i], &sum);
+        double plane = time_setup(setup_from_plane, columns[i], &sum);
+
+        printf("columns=%-5d angles %8.2f us/frame  plane %7.2f us/frame  %6.1fx\n", columns[i],
+               angles * 1e6, plane * 1e6, angles / plane);
+    }
+    printf("(sum %.3g)\n", sum);
+    return 0;
+}
+
+// Scatters BENCH_SPRITES sprites over open cells 2 to 100 cells ahead of the
+// arena centre, all inside the view cone of a camera looking east from there.
+// They spread evenly over the floor, as items placed across a level would,
+// so most are far away and small.
+static int place_sprites(t_sprites *sprites, const t_grid *grid)
+{
+    double half_fov = deg_to_radian(FOV) / 2;
+    uint32_t seed = 0x1B873593;
+
+    while (sprites->count < BENCH_SPRITES) {
+        double dist = sqrt(4 + (100 * 100 - 4) * (bench_rand(&seed) % 10001 / 10000.0));
+        double angle = (bench_rand(&seed) % 2001 / 1000.0 - 1) * half_fov * 0.95;
+        int x = grid->width / 2 + (int)(dist * cos(angle));
+        int y = grid->height / 2 + (int)(dist * sin(angle));
+
+        if (grid_solid(grid, x, y))
+            continue;
+        if (sprites_add(sprites, (x + 0.5f) * TILE_SIZE, (y + 0.5f) * TILE_SIZE) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int run_sprites(void)
+{
+    t_player player;
+    double with[BENCH_SPRITE_FRAMES];
+    double without[BENCH_SPRITE_FRAMES];
+    t_grid *grid = &player.scene.grid;
+    t_sprites *sprites = &player.scene.sprites;
+
+    memset(&player, 0, sizeof(t_player));
+    player.size = 6;
+    player.view = headless_image(BENCH_WIDTH, BENCH_HEIGHT);
+    player.direction_ray = headless_image(BENCH_WIDTH, BENCH_HEIGHT);
+    if (!player.view || !player.direction_ray || make_textures(player.scene.surfaces) != 0
+        || caster_init(&player.caster, pool_default_threads()) != 0
+        || caster_reserve(&player.caster, BENCH_WIDTH, BENCH_HEIGHT) != 0
+        || make_arena(grid, 256, BENCH_PILLAR_SPACING) != 0 || place_sprites(sprites, grid) != 0) {
+        fprintf(stderr, "Error\ncannot set up the benchmark\n");
+        return 1;
+    }
+    player.direction_ray->enabled = false;
+    player.x_pos = grid->width / 2.0 * TILE_SIZE - player.size / 2.0;
+    player.y_pos = grid->height / 2.0 * TILE_SIZE - player.size / 2.0;
+    t_pose pose = player_pose(&player);
+
+    // Interleaved so both sides see the same machine noise
+    for (int frame = -BENCH_WARMUP_FRAMES; frame < BENCH_SPRITE_FRAMES; frame++) {
+        for (int pass = 0; pass < 2; pass++) {
+            int count = sprites->count;
+            double start;
+
+            sprites->count = pass ? count : 0;
+            start = now();
+            render_frame(&player, &pose);
+            if (frame >= 0)
+                (pass ? with : without)[frame] = now() - start;
+            sprites->count = count;
+        }
+    }
+    qsort(with, BENCH_SPRITE_FRAMES, sizeof(double), compare_times);
+    qsort(without, BENCH_SPRITE_FRAMES, sizeof(double), compare_times);
+    printf("sprites=%d visible=%d threads=%d frame_p50_ms=%.4f no_sprites_p50_ms=%.4f sprites_ms=%.4f\n",
+           sprites->count, sprites->visible, pool_default_threads(),
+           percentile(with, BENCH_SPRITE_FRAMES, 0.50) * 1e3,
+           percentile(without, BENCH_SPRITE_FRAMES, 0.50) * 1e3,
+           (percentile(with, BENCH_SPRITE_FRAMES, 0.50) - percentile(without, BENCH_SPRITE_FRAMES, 0.50)) * 1e3);
+    caster_destroy(&player.caster);
+    for (int i = 0; i < TEX_COUNT; i++)
+        texture_destroy(&player.scene.surfaces[i]);
+    sprites_destroy(sprites);
+    grid_destroy(grid);
+    headless_image_delete(player.view);
+    headless_image_delete(player.direction_ray);
+    return 0;
+}
+
+typedef struct s_body
+{
+    t_box box;
+    double vx;
+    double vy;
+} t_body;
+
+// Bodies on open cells of the grid, each with a random velocity of up to
+// three cells per tick
+static void place_bodies(t_body *bodies, const t_grid *grid)
+{
+    uint32_t seed = 0x85EBCA6B;
+
+    for (int i = 0; i < BENCH_BODIES; i++) {
+        int x;
+        int y;
+
+        do {
+            x = bench_rand(&seed) % grid->width;
+            y = bench_rand(&seed) % grid->height;
+        } while (grid_solid(grid, x, y));
+        bodies[i].box = (t_box){x * TILE_SIZE + 4, y * TILE_SIZE + 4, BENCH_BODY_SIZE, BENCH_BODY_SIZE};
+        bodies[i].vx = (bench_rand(&seed) % 2001 / 1000.0 - 1) * 3 * TILE_SIZE;
+        bodies[i].vy = (bench_rand(&seed) % 2001 / 1000.0 - 1) * 3 * TILE_SIZE;
+    }
+}
+
+// One tick of swept moves: each body slides along the first wall it meets
+// and bounces off it
+static void tick_swept(t_body *bodies, const t_grid *grid)
+{
+    for (int i = 0; i < BENCH_BODIES; i++) {
+        t_body *body = &bodies[i];
+        t_contact contact;
+
+        if (!collide_move(grid, &body->box, body->vx, body->vy, &contact)) {
+            body->box.x += body->vx;
+            body->box.y += body->vy;
+            continue;
+        }
+        body->box.x += body->vx * contact.time;
+        body->box.y += body->vy * contact.time;
+        body->vx = contact.normal_x ? -body->vx : body->vx;
+        body->vy = contact.normal_y ? -body->vy : body->vy;
+
+        double slide_x = contact.slide_x;
+        double slide_y = contact.slide_y;
+
+        collide_move(grid, &body->box, slide_x, slide_y, &contact);
+        body->box.x += slide_x * contact.time;
+        body->box.y += slide_y * contact.time;
+    }
+}
+
+// The same tick substepping instead: box tests at most a body size apart,
+// stopping a body (and bouncing it) at the first substep that hits. Moves
+// that cut a wall corner between two substeps still get through.
+static void tick_substep(t_body *bodies, const t_grid *grid)
+{
+    for (int i = 0; i < BENCH_BODIES; i++) {
+        t_body *body = &bodies[i];
+        double reach = fmax(fabs(body->vx), fabs(body->vy));
+        int steps = (int)ceil(reach / BENCH_BODY_SIZE);
+
+        for (int step = 0; step < steps; step++) {
+            t_box next = body->box;
+
+            next.x += body->vx / steps;
+            next.y += body->vy / steps;
+            if (collide_box(grid, &next)) {
+                body->vx = -body->vx;
+                body->vy = -body->vy;
+                break;
+            }
+            body->box = next;
+        }
+    }
+}
+
+// Bodies whose straight move from where they were passed through a wall,
+// by the swept test
+static int count_tunnelled(const t_body *before, const t_body *after, const t_grid *grid)
+{
+    int tunnelled = 0;
+
+    for (int i = 0; i < BENCH_BODIES; i++) {
+        t_contact contact;
+
+        tunnelled += collide_move(grid, &before[i].box, after[i].box.x - before[i].box.x,
+                                  after[i].box.y - before[i].box.y, &contact)
+                     && contact.time < 1 - 1e-9;
+    }
+    return tunnelled;
+}
+
+static int run_bodies(void)
+{
+    t_body *bodies = malloc(BENCH_BODIES * sizeof(t_body));
+    t_body *start = malloc(BENCH_BODIES * sizeof(t_body));
+    t_body *before = malloc(BENCH_BODIES * sizeof(t_body));
+    double swept[BENCH_BODY_TICKS];
+    double substep[BENCH_BODY_TICKS];
+    int tunnelled = 0;
+    t_grid grid;
+
+    if (!bodies || !start || !before || make_arena(&grid, 256, 4) != 0) {
+        fprintf(stderr, "Error\ncannot set up the benchmark\n");
+        return 1;
+    }
+    place_bodies(start, &grid);
+    for (int pass = 0; pass < 2; pass++) {
+        double *times = pass ? substep : swept;
+
+        memcpy(bodies, start, BENCH_BODIES * sizeof(t_body));
+        for (int tick = 0; tick < BENCH_BODY_TICKS; tick++) {
+            double begin;
+
+            memcpy(before, bodies, BENCH_BODIES * sizeof(t_body));
+            begin = now();
+            (pass ? tick_substep : tick_swept)(bodies, &grid);
+            times[tick] = now() - begin;
+            if (pass)
+                tunnelled += count_tunnelled(before, bodies, &grid);
+        }
+        qsort(times, BENCH_BODY_TICKS, sizeof(double), compare_times);
+    }
+    printf("bodies=%d ticks=%d swept_tick_p50_us=%.1f substep_tick_p50_us=%.1f"
+           " substep_tunnelled=%d\n",
+           BENCH_BODIES, BENCH_BODY_TICKS,
+           percentile(swept, BENCH_BODY_TICKS, 0.50) * 1e6,
+           percentile(substep, BENCH_BODY_TICKS, 0.50) * 1e6,
+           tunnelled);
+    grid_destroy(&grid);
+    free(bodies);
+    free(before);
+    free(start);
+    return 0;
+}
+
+// When, as a fraction of the move, the extent [pos, pos + size) moving by
+// move overlaps cell by more than COLLIDE_EPSILON: from *enter to *leave
+static void cell_slab(double pos, double size, double move, int cell, double *enter, double *leave)
+{
+    double lo = (double)cell * TILE_SIZE + COLLIDE_EPSILON;
+    double hi = (double)(cell + 1) * TILE_SIZE - COLLIDE_EPSILON;
+
+    if (move == 0) {
+        int inside = pos + size > lo && pos < hi;
+
+        *enter = inside ? -INFINITY : INFINITY;
+        *leave = inside ? INFINITY : -INFINITY;
+        return;
+    }
+    double t_lo = (lo - pos - size) / move;
+    double t_hi = (hi - pos) / move;
+
+    *enter = fmin(t_lo, t_hi);
+    *leave = fmax(t_lo, t_hi);
+}
+
+// First time in [0, 1) at which box, moving by (dx, dy), overlaps a wall
+// cell by more than COLLIDE_EPSILON on both axes, or 2 if it never does.
+// Tries every cell the move's bounding box touches, as the reference for
+// run_collide.
+static double reference_move(const t_grid *grid, const t_box *box, double dx, double dy)
+{
+    int x0 = (int)floor(fmin(box->x, box->x + dx) / TILE_SIZE);
+    int x1 = (int)floor((fmax(box->x, box->x + dx) + box->width) / TILE_SIZE);
+    int y0 = (int)floor(fmin(box->y, box->y + dy) / TILE_SIZE);
+    int y1 = (int)floor((fmax(box->y, box->y + dy) + box->height) / TILE_SIZE);
+    double first = 2;
+
+    for (int y = y0 < -1 ? -1 : y0; y <= y1 && y <= grid->height; y++)
+        for (int x = x0 < -1 ? -1 : x0; x <= x1 && x <= grid->width; x++) {
+            double enter_x, leave_x, enter_y, leave_y;
+
+            if (!grid_solid(grid, x, y))
+                continue;
+            cell_slab(box->x, box->width, dx, x, &enter_x, &leave_x);
+            cell_slab(box->y, box->height, dy, y, &enter_y, &leave_y);
+            double enter = fmax(fmax(enter_x, enter_y), 0);
+            double leave = fmin(leave_x, leave_y);
+
+            if (enter < leave && enter < 1 && enter < first)
+                first = enter;
+        }
+    return first;
+}
+
+// Whether box covers any of the wall cells it is over at all, cell by cell
+static int reference_box(const t_grid *grid, const t_box *box)
+{
+    int x0 = (int)floor(box->x / TILE_SIZE);
+    int y0 = (int)floor(box->y / TILE_SIZE);
+
+    for (int y = y0 < -1 ? -1 : y0; y <= (box->y + box->height) / TILE_SIZE && y <= grid->height; y++)
+        for (int x = x0 < -1 ? -1 : x0; x <= (box->x + box->width) / TILE_SIZE && x <= grid->width; x++)
+            if (grid_solid(grid, x, y) && box->x < (x + 1) * TILE_SIZE && box->x + box->width > x * TILE_SIZE
+                && box->y < (y + 1) * TILE_SIZE && box->y + box->height > y * TILE_SIZE)
+                return 1;
+    return 0;
+}
+
+// Random value in [lo, lo + span) in whole hundredths
+static double bench_hundredths(uint32_t *seed, double lo, double span)
+{
+    return lo + bench_rand(seed) % (uint32_t)(span * 100) / 100.0;
+}
+
+// Pillars two cells square every four cells: walls close together on every
+// side, so most moves meet one
+static int make_pillars(t_grid *grid)
+{
+    return make_arena(grid, 64, 4);
+}
+
+static int run_collide(void)
+{
+    static const t_bench_map maps[] = {
+        {"pillars", make_pillars},
+        {"corridors", make_corridors},
+    };
+    int status = 0;
+
+    for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); i++) {
+        t_grid grid;
+        uint32_t seed = 0x7F4A7C15;
+        long hits = 0;
+        long moves_wrong = 0;
+        long boxes_wrong = 0;
+        long points_wrong = 0;
+
+        if (maps[i].make(&grid) != 0)
+            return 1;
+        for (int done = 0; done < BENCH_COLLIDE_MOVES;) {
+            int cx = bench_rand(&seed) % grid.width;
+            int cy = bench_rand(&seed) % grid.height;
+            t_box box = {bench_hundredths(&seed, cx * TILE_SIZE, TILE_SIZE),
+                         bench_hundredths(&seed, cy * TILE_SIZE, TILE_SIZE),
+                         bench_hundredths(&seed, 1, 40), bench_hundredths(&seed, 1, 40)};
+            // Points as far as two cells off the map answer solid
+            double px = bench_hundredths(&seed, -2 * TILE_SIZE, (grid.width + 4) * TILE_SIZE);
+            double py = bench_hundredths(&seed, -2 * TILE_SIZE, (grid.height + 4) * TILE_SIZE);
+            int pcx = (int)floor(px / TILE_SIZE);
+            int pcy = (int)floor(py / TILE_SIZE);
+            int point = pcx < 0 || pcy < 0 || pcx >= grid.width || pcy >= grid.height || grid_solid(&grid, pcx, pcy);
+
+            points_wrong += collide_point(&grid, px, py) != point;
+            int covered = reference_box(&grid, &box);
+            boxes_wrong += collide_box(&grid, &box) != covered;
+            // Moves start clear of walls, cell cover within COLLIDE_EPSILON aside
+            if (covered && reference_move(&grid, &box, 0, 0) < 1)
+                continue;
+
+            double dx = bench_hundredths(&seed, -3 * TILE_SIZE, 6 * TILE_SIZE);
+            double dy = bench_hundredths(&seed, -3 * TILE_SIZE, 6 * TILE_SIZE);
+            double first = reference_move(&grid, &box, dx, dy);
+            t_contact contact;
+            int hit = collide_move(&grid, &box, dx, dy, &contact);
+
+            done++;
+            hits += hit;
+            if (hit != (first < 1)) {
+                moves_wrong++;
+                continue;
+            }
+            if (!hit)
+                continue;
+            // Touching comes at most COLLIDE_EPSILON, along the face normal,
+            // before the overlap does
+            double along = contact.normal_x ? fabs(dx) : fabs(dy);
+            double early = (first - contact.time) * along;
+
+            moves_wrong += early < -1e-9 || early > COLLIDE_EPSILON + 1e-9;
+        }
+        printf("map=%-9s moves %d  hits %ld  moves wrong %ld  boxes wrong %ld  points wrong %ld\n",
+               maps[i].name, BENCH_COLLIDE_MOVES, hits, moves_wrong, boxes_wrong, points_wrong);
+        status |= moves_wrong > 0 || boxes_wrong > 0 || points_wrong > 0;
+        grid_destroy(&grid);
+    }
+    return status;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "skip") == 0)
+        return run_skip_compare();
+    if (argc == 2 && strcmp(argv[1], "sprites") == 0)
+        return run_sprites();
+    if (argc == 2 && strcmp(argv[1], "turn") == 0)
+        return run_turn();
+    if (argc == 2 && strcmp(argv[1], "temporal") == 0)
+        return run_temporal();
+    if (argc == 2 && strcmp(argv[1], "accuracy") == 0)
+        return run_accuracy();
+    if (argc == 2 && strcmp(argv[1], "batch") == 0)
+        return run_batch();
+    if (argc == 2 && strcmp(argv[1], "trig") == 0)
+        return run_trig();
+    if (argc == 2 && strcmp(argv[1], "ray-setup") == 0)
+        return run_ray_setup();
+    if (argc == 2 && strcmp(argv[1], "bodies") == 0)
+        return run_bodies();
+    if (argc == 2 && strcmp(argv[1], "collide") == 0)
+        return run_collide();
+    if (argc != 1) {
+        fprintf(stderr, "Error\nusage: %s [skip | sprites | turn | temporal | accuracy | batch | trig | ray-setup | bodies | collide]\n", argv[0]);
+        return 1;
+    }
+    return run_suite();
+}
@@ -0,0 +1,395 @@
+#include "cub3d.h"
+
+float deg_to_radian(float deg)
+{
+    return (deg * PI / 180);
+}
+
+// Angle in [0, 2 PI). With CUB3D_TRIG_TABLES it is also rounded to binary
+// units, which wrap without an fmod and land exactly on table entries.
+float normalize_angle(float angle)
+{
+#ifdef CUB3D_TRIG_TABLES
+    return angle_to_radians(angle_from_radians(angle));
+#else
+    angle = fmod(angle ,2 * PI);
+    if (angle < 0)
+        angle = (2 * PI) + angle;
+    return angle;
+#endif
+}
+
+void camera_from_angle(t_camera *camera, double angle, double fov)
+{
+    double half_width = angle_tan(fov / 2);
+
+    camera->dir_x = angle_cos(angle);
+    camera->dir_y = angle_sin(angle);
+    camera->plane_x = -camera->dir_y * half_width;
+    camera->plane_y = camera->dir_x * half_width;
+}
+
+// CUB3D_RING=0 leaves the ray ring out and CUB3D_TEMPORAL=0 stops reusing
+// last frame's hits, e.g. to compare against casting every column.
+// CUB3D_MIPMAP=0 samples full-size textures at any distance, to compare.
+int caster_init(t_caster *caster, int n_threads)
+{
+    char *ring = getenv("CUB3D_RING");
+    char *temporal = getenv("CUB3D_TEMPORAL");
+    char *mipmap = getenv("CUB3D_MIPMAP");
+
+    memset(caster, 0, sizeof(t_caster));
+    caster->temporal = !(temporal && *temporal == '0');
+    caster->packet = dda_select_packet();
+    caster->span = surface_select_span();
+    caster->sprite_kernel = sprite_select_kernel();
+    caster->mipmap = !(mipmap && *mipmap == '0');
+    caster->pool = pool_create(n_threads);
+    if (!caster->pool)
+        return -1;
+    if (ring && *ring == '0')
+        return 0;
+    caster->ring = calloc(RING_SLOTS, sizeof(t_ring_slot));
+    return caster->ring ? 0 : -1;
+}
+
+// Sizes the per-frame buffers for a view columns wide and rows high, sprite
+// masks included. Call once the view size is known, so running out of
+// memory shows up before the first frame; caster_cast only ever grows the
+// column buffers.
+int caster_reserve(t_caster *caster, int columns, int rows)
+{
+    if (rows > caster->rows) {
+        size_t words = (size_t)caster->pool->n_threads * rows;
+        uint64_t *covered = realloc(caster->covered, words * sizeof(uint64_t));
+        if (!covered)
+            return -1;
+        caster->covered = covered;
+        caster->rows = rows;
+    }
+    if (columns <= caster->capacity)
+        return 0;
+    int *recast = realloc(caster->recast, columns * sizeof(int));
+    if (!recast)
+        return -1;
+    caster->recast = recast;
+    if (ray_batch_reserve(&caster->batch, columns) != 0)
+        return -1;
+    caster->zbuffer = caster->batch.dist;
+    caster->capacity = columns;
+    return 0;
+}
+
+// Casts the given columns as one packet; lanes past count repeat the last
+// column and are not stored
+static void caster_cast_packet(t_caster *caster, const int *columns, int count)
+{
+    double dir_x[RAY_PACKET];
+    double dir_y[RAY_PACKET];
+    double dist[RAY_PACKET];
+    int side[RAY_PACKET];
+    int cell_x[RAY_PACKET];
+    int cell_y[RAY_PACKET];
+
+    for (int lane = 0; lane < RAY_PACKET; lane++) {
+        int column = columns[lane < count ? lane : count - 1];
+
+        dir_x[lane] = caster->ray0_x + column * caster->ray_step_x;
+        dir_y[lane] = caster->ray0_y + column * caster->ray_step_y;
+    }
+    caster->packet(caster->grid, caster->origin_x, caster->origin_y, dir_x, dir_y, dist, side, cell_x, cell_y);
+    for (int lane = 0; lane < count; lane++)
+        ray_batch_store(&caster->batch, columns[lane], caster->origin_x, caster->origin_y, dir_x[lane],
+                        dir_y[lane], dist[lane], side[lane], cell_x[lane], cell_y[lane]);
+}
+
+// Casts columns [begin, end) in packets of RAY_PACKET adjacent columns. Each
+// column only writes its own hit slot and lanes never interact, so the result
+// is identical whatever way the range is split across threads.
+static void caster_cast_range(void *ctx, int begin, int end)
+{
+    t_caster *caster = (t_caster *)ctx;
+    int columns[RAY_PACKET];
+
+    for (int i = begin; i < end; i += RAY_PACKET) {
+        int lanes = end - i < RAY_PACKET ? end - i : RAY_PACKET;
+
+        for (int lane = 0; lane < lanes; lane++)
+            columns[lane] = i + lane;
+        caster_cast_packet(caster, columns, lanes);
+    }
+}
+
+// Casts recast[begin, end) the same way
+static void caster_recast_range(void *ctx, int begin, int end)
+{
+    t_caster *caster = (t_caster *)ctx;
+
+    for (int i = begin; i < end; i += RAY_PACKET)
+        caster_cast_packet(caster, caster->recast + i, end - i < RAY_PACKET ? end - i : RAY_PACKET);
+}
+
+// How far ring_nearest looks for a filled slot either side
+#define RING_REACH 8
+// Most rows (or columns) of cells segment_clear walks before giving up
+#define TEMPORAL_MAX_SPAN 8
+// Hits nearer than this many cells are cast again straight away: a packet
+// finds them quicker than their line can be checked
+#define TEMPORAL_MIN_DIST 4
+
+// Ring slot for a direction. The slot is picked by "diamond angle", which
+// runs from 0 to 4 round the circle like the angle does but takes one
+// division instead of atan2; slots are up to twice as wide near the
+// diagonals as along the axes.
+static int ring_slot(double dir_x, double dir_y)
+{
+    double p = dir_x / (fabs(dir_x) + fabs(dir_y));
+    double angle = dir_y < 0 ? 3 + p : 1 - p;
+
+    return (int)(angle * (RING_SLOTS / 4) + 0.5) & (RING_SLOTS - 1);
+}
+
+// Writes down which grid line the column's ray hit, and where along it, in
+// its direction's slot
+static void ring_record(t_caster *caster, int column)
+{
+    double dir_x = caster->ray0_x + column * caster->ray_step_x;
+    double dir_y = caster->ray0_y + column * caster->ray_step_y;
+    int side = caster->batch.side[column];
+    double dist = caster->batch.dist[column];
+    t_ring_slot *slot = &caster->ring[ring_slot(dir_x, dir_y)];
+    double at = side == 0 ? caster->origin_x + dir_x * dist : caster->origin_y + dir_y * dist;
+    double along = side == 0 ? caster->origin_y + dir_y * dist : caster->origin_x + dir_x * dist;
+
+    slot->along = along / TILE_SIZE;
+    slot->side = side;
+    slot->line = (int)lround(at / TILE_SIZE);
+    slot->stamp = caster->ring_stamp;
+}
+
+// Nearest slot from this origin past index, stepping by step and looking
+// RING_REACH slots at most. The slots are finer than the columns, so most
+// of them stay empty.
+static const t_ring_slot *ring_nearest(const t_caster *caster, int index, int step)
+{
+    for (int i = 1; i <= RING_REACH; i++) {
+        const t_ring_slot *slot = &caster->ring[(index + i * step) & (RING_SLOTS - 1)];
+
+        if (slot->stamp == caster->ring_stamp)
+            return slot;
+    }
+    return NULL;
+}
+
+// Whether the segment from (x0, y0) to (x1, y1), in cells, crosses no wall.
+// Walks the axis the segment moves less along, one row (or column) of cells
+// at a time, and tests the run of cells it covers there as one bitmap range.
+// Runs are half-open at the far end, so a segment ending on a wall face
+// does not take in the wall behind it. Fails too past TEMPORAL_MAX_SPAN
+// rows, where casting is cheaper.
+static int segment_clear(const t_grid *grid, double x0, double y0, double x1, double y1)
+{
+    int rows = fabs(x1 - x0) >= fabs(y1 - y0);
+    double a0 = rows ? y0 : x0;
+    double a1 = rows ? y1 : x1;
+    double b0 = rows ? x0 : y0;
+    double b1 = rows ? x1 : y1;
+    double lo = a0 < a1 ? a0 : a1;
+    double hi = a0 < a1 ? a1 : a0;
+    double slope = a1 != a0 ? (b1 - b0) / (a1 - a0) : 0;
+    int first = cell_floor(lo);
+    int last = cell_ceil(hi) - 1;
+
+    last = last < first ? first : last;
+    if (last - first >= TEMPORAL_MAX_SPAN)
+        return 0;
+    for (int line = first; line <= last; line++) {
+        double from = a1 != a0 ? b0 + ((line > lo ? line : lo) - a0) * slope : b0;
+        double to = a1 != a0 ? b0 + ((line + 1 < hi ? line + 1 : hi) - a0) * slope : b1;
+        int c0 = cell_floor(from < to ? from : to);
+        int c1 = cell_ceil(from < to ? to : from) - 1;
+
+        c1 = c1 < c0 ? c0 : c1;
+        if (rows ? grid_row_solid(grid, line, c0, c1) : grid_column_solid(grid, line, c0, c1))
+            return 0;
+    }
+    return 1;
+}
+
+// Takes the column's hit from grid line line (an x line for side 0, a y line
+// for side 1): where the column's ray meets it, provided that is a face, a
+// wall cell behind the line and an open one in front. With check_path the
+// way there must be clear too. Returns 0 when the column has to be cast.
+static int line_hit(t_caster *caster, int column, int side, int line, int check_path)
+{
+    double dir_x = caster->ray0_x + column * caster->ray_step_x;
+    double dir_y = caster->ray0_y + column * caster->ray_step_y;
+    const t_grid *grid = caster->grid;
+    int ahead = side == 0 ? dir_x > 0 : dir_y > 0;
+    int behind = ahead ? line : line - 1;
+    int front = ahead ? line - 1 : line;
+    double along;
+    int cell;
+    // The cast's own arithmetic, so a reused hit is bit for bit the one a
+    // cast would give, in fixed point as well
+    double dist = ray_line_hit(caster->origin_x, caster->origin_y, dir_x, dir_y, side, behind, &along, &cell);
+
+    // Lines hit lie between border cells, so only along needs a range check
+    // before the cells either side of the line are looked up
+    if (!(dist > 0) || !(along >= 0) || along >= (side == 0 ? grid->height : grid->width))
+        return 0;
+    if (side == 0 ? !grid_solid(grid, behind, cell) || grid_solid(grid, front, cell)
+                  : !grid_solid(grid, cell, behind) || grid_solid(grid, cell, front))
+        return 0;
+    if (check_path && !segment_clear(grid, caster->origin_x / TILE_SIZE, caster->origin_y / TILE_SIZE,
+                                     side == 0 ? line : along, side == 0 ? along : line))
+        return 0;
+    ray_batch_store(&caster->batch, column, caster->origin_x, caster->origin_y, dir_x, dir_y, dist, side,
+                    side == 0 ? behind : cell, side == 0 ? cell : behind);
+    return 1;
+}
+
+// Takes the column's hit from the ring. The nearest filled slots below and
+// above the column's own must have hit the same grid line (and so must its
+// own slot, if filled), less than a cell apart along it; the hit is then
+// where the column's ray meets that line. A ray crosses a line once, so
+// nothing in front of the line can start between those two recorded rays
+// and reach past either of them, and the gap between them, under a cell
+// wide at the line and narrower nearer, has no room for a wall cell either.
+// The ray must still meet the line at a face, or it went through a gap.
+static int ring_resample(t_caster *caster, int column)
+{
+    double dir_x = caster->ray0_x + column * caster->ray_step_x;
+    double dir_y = caster->ray0_y + column * caster->ray_step_y;
+    int index = ring_slot(dir_x, dir_y);
+    const t_ring_slot *own = &caster->ring[index];
+    const t_ring_slot *lower = ring_nearest(caster, index, -1);
+    const t_ring_slot *upper = ring_nearest(caster, index, 1);
+
+    if (!lower || !upper || upper->side != lower->side || upper->line != lower->line
+        || !(fabs(upper->along - lower->along) < 1)
+        || (own->stamp == caster->ring_stamp && (own->side != lower->side || own->line != lower->line)))
+        return 0;
+    return line_hit(caster, column, lower->side, lower->line, 0);
+}
+
+// Resamples columns [begin, end) from the ring, marking the ones it cannot
+// with side -1
+static void ring_resample_range(void *ctx, int begin, int end)
+{
+    t_caster *caster = (t_caster *)ctx;
+
+    for (int i = begin; i < end; i++)
+        if (!ring_resample(caster, i))
+            caster->batch.side[i] = -1;
+}
+
+// Tries the grid line each of columns [begin, end) hit last frame, along
+// last frame's ray from last_x, last_y, marking the ones that need casting
+// with side -1. A player moves a couple of pixels a frame, so most columns
+// still end on the same wall line and only need their way there checked.
+static void temporal_range(void *ctx, int begin, int end)
+{
+    t_caster *caster = (t_caster *)ctx;
+    t_ray_batch *batch = &caster->batch;
+
+    for (int i = begin; i < end; i++) {
+        double dir_x = caster->last_ray0_x + i * caster->last_ray_step_x;
+        double dir_y = caster->last_ray0_y + i * caster->last_ray_step_y;
+        double at = batch->side[i] == 0 ? caster->last_x + dir_x * batch->dist[i]
+                                        : caster->last_y + dir_y * batch->dist[i];
+
+        if (batch->dist[i] < TEMPORAL_MIN_DIST * TILE_SIZE
+            || !line_hit(caster, i, batch->side[i], (int)(at / TILE_SIZE + 0.5), 1))
+            batch->side[i] = -1;
+    }
+}
+
+// Forgets every slot by moving on to a new stamp; only once the stamp wraps
+// round do old slots need clearing
+static void ring_reset(t_caster *caster, const t_grid *grid)
+{
+    if (++caster->ring_stamp == 0) {
+        memset(caster->ring, 0, RING_SLOTS * sizeof(t_ring_slot));
+        caster->ring_stamp = 1;
+    }
+    caster->ring_x = caster->origin_x;
+    caster->ring_y = caster->origin_y;
+    caster->ring_generation = grid->generation;
+}
+
+// Casts the columns temporal_range or ring_resample_range marked
+static void caster_recast_marked(t_caster *caster)
+{
+    caster->recast_count = 0;
+    for (int i = 0; i < caster->count; i++)
+        if (caster->batch.side[i] < 0)
+            caster->recast[caster->recast_count++] = i;
+    if (caster->recast_count > 0)
+        pool_run(caster->pool, caster_recast_range, caster, caster->recast_count);
+}
+
+// Ray directions are interpolated across the camera plane, from dir - plane
+// at column 0 towards dir + plane, so no column needs any trigonometry.
+// A frame from a new origin first tries each column's wall line from last
+// frame (when last frame cast as many columns on the same grid) and casts
+// the columns where that fails; the lines hit go into the ring. Frames from
+// the same origin (the view only turned) resample what they can from the
+// ring and cast only the rest, typically the columns turned into view.
+// Both only trust hits taken on the grid's current generation.
+void caster_cast(t_caster *caster, const t_grid *grid, double origin_x, double origin_y,
+                 const t_camera *camera, int count)
+{
+    int coherent = caster->temporal && caster->count == count && caster->grid == grid
+        && caster->generation == grid->generation;
+
+    if (caster_reserve(caster, count, caster->rows) != 0) {
+        caster->count = 0;
+        return;
+    }
+    caster->last_x = caster->origin_x;
+    caster->last_y = caster->origin_y;
+    caster->last_ray0_x = caster->ray0_x;
+    caster->last_ray0_y = caster->ray0_y;
+    caster->last_ray_step_x = caster->ray_step_x;
+    caster->last_ray_step_y = caster->ray_step_y;
+    caster->count = count;
+    caster->grid = grid;
+    caster->generation = grid->generation;
+    caster->origin_x = origin_x;
+    caster->origin_y = origin_y;
+    caster->ray0_x = camera->dir_x - camera->plane_x;
+    caster->ray0_y = camera->dir_y - camera->plane_y;
+    caster->ray_step_x = 2 * camera->plane_x / count;
+    caster->ray_step_y = 2 * camera->plane_y / count;
+    if (caster->ring && origin_x == caster->ring_x && origin_y == caster->ring_y
+        && grid->generation == caster->ring_generation) {
+        pool_run(caster->pool, ring_resample_range, caster, count);
+        caster_recast_marked(caster);
+        for (int i = 0; i < caster->recast_count; i++)
+            ring_record(caster, caster->recast[i]);
+        return;
+    }
+    if (coherent) {
+        pool_run(caster->pool, temporal_range, caster, count);
+        caster_recast_marked(caster);
+    } else {
+        caster->recast_count = count;
+        pool_run(caster->pool, caster_cast_range, caster, count);
+    }
+    if (caster->ring) {
+        ring_reset(caster, grid);
+        for (int i = 0; i < count; i++)
+            ring_record(caster, i);
+    }
+}
+
+void caster_destroy(t_caster *caster)
+{
+    pool_destroy(caster->pool);
+    free(caster->recast);
+    free(caster->covered);
+    free(caster->ring);
+    ray_batch_destroy(&caster->batch);
+    memset(caster, 0, sizeof(t_caster));
+}
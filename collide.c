@@ -0,0 +1,164 @@
+#include "cub3d.h"
+
+// Wall queries for anything that moves through the map, in world pixels.
+// Coordinates are clamped onto the wall border first, so positions off the
+// map answer solid like the border does and no query needs a bounds branch.
+
+// Cell holding world coordinate v, clamped to [-1, limit]
+static inline int cell_of(double v, int limit)
+{
+    double cell = floor(v / TILE_SIZE);
+
+    cell = cell < -1 ? -1 : cell;
+    cell = cell > limit ? limit : cell;
+    return (int)cell;
+}
+
+// Cell holding the last pixel of an extent ending at v (exclusive)
+static inline int last_cell_of(double v, int limit)
+{
+    double cell = ceil(v / TILE_SIZE) - 1;
+
+    cell = cell < -1 ? -1 : cell;
+    cell = cell > limit ? limit : cell;
+    return (int)cell;
+}
+
+// Wall test for the cells x0..x1 by y0..y1 (already clamped)
+static int cells_solid(const t_grid *grid, int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y <= y1; y++)
+        if (grid_row_solid(grid, y, x0, x1))
+            return 1;
+    return 0;
+}
+
+int collide_point(const t_grid *grid, double x, double y)
+{
+    return grid_solid(grid, cell_of(x, grid->width), cell_of(y, grid->height));
+}
+
+// A box no bigger than a cell touches at most 2x2 cells, so this is a fixed
+// handful of word tests; bigger boxes cost one test per row of cells.
+int collide_box(const t_grid *grid, const t_box *box)
+{
+    return cells_solid(grid,
+                       cell_of(box->x, grid->width), cell_of(box->y, grid->height),
+                       last_cell_of(box->x + box->width, grid->width),
+                       last_cell_of(box->y + box->height, grid->height));
+}
+
+static inline int clamp_cell(int cell, int limit)
+{
+    cell = cell < -1 ? -1 : cell;
+    return cell > limit ? limit : cell;
+}
+
+// One axis of a swept box: the cell holding its leading edge and the time
+// (as a fraction of the move) at which that edge crosses into the next one
+typedef struct s_sweep_axis
+{
+    double pos;
+    double size;
+    double move;
+    int step;
+    int lead;
+    int limit;
+    double next;
+} t_sweep_axis;
+
+static void sweep_axis_init(t_sweep_axis *axis, double pos, double size, double move, int limit)
+{
+    axis->pos = pos;
+    axis->size = size;
+    axis->move = move;
+    axis->step = move < 0 ? -1 : 1;
+    axis->limit = limit;
+    axis->lead = cell_of(move < 0 ? pos + COLLIDE_EPSILON : pos + size - COLLIDE_EPSILON, limit);
+}
+
+// Time the leading edge reaches the far side of its cell, or never (2) when
+// it does not get COLLIDE_EPSILON past it within the move: a box that ends
+// the move flush against the next cell only touches it. Crossings only get
+// later, so once one is out of reach all are.
+static void sweep_axis_next(t_sweep_axis *axis)
+{
+    double line;
+    double t;
+
+    if (axis->move == 0) {
+        axis->next = 2;
+        return;
+    }
+    if (axis->move < 0) {
+        line = (double)axis->lead * TILE_SIZE;
+        t = (line - axis->pos) / axis->move;
+        axis->next = axis->pos + axis->move < line - COLLIDE_EPSILON ? t : 2;
+    } else {
+        line = (double)(axis->lead + 1) * TILE_SIZE;
+        t = (line - axis->pos - axis->size) / axis->move;
+        axis->next = axis->pos + axis->size + axis->move > line + COLLIDE_EPSILON ? t : 2;
+    }
+    axis->next = axis->next > 0 ? axis->next : 0;
+}
+
+// Cells the box spans along this axis at time t: from the cell its trailing
+// edge is in then to the leading cell, which only moves on a crossing
+static void sweep_axis_span(const t_sweep_axis *axis, double t, int *first, int *last)
+{
+    double pos = axis->pos + axis->move * t;
+    int trail = cell_of(axis->move < 0 ? pos + axis->size - COLLIDE_EPSILON : pos + COLLIDE_EPSILON,
+                        axis->limit);
+
+    *first = trail < axis->lead ? trail : axis->lead;
+    *last = trail < axis->lead ? axis->lead : trail;
+}
+
+// Moves box by (dx, dy) through the grid and stops it at the first wall.
+// A DDA over the box's leading edges visits only the row or column of cells
+// the box enters at each grid line it crosses, so the cost grows with the
+// cells crossed, not with the speed, and nothing tunnels. Cells the box
+// already overlaps at the start are not tested, so a body stuck in a wall
+// can still move out of it.
+// Returns whether a wall was hit. contact gets the fraction of the move made
+// before the hit (1 without one), the face normal of the wall hit, and the
+// rest of the move along that wall: moving by it next slides the box on.
+int collide_move(const t_grid *grid, const t_box *box, double dx, double dy, t_contact *contact)
+{
+    t_sweep_axis ax;
+    t_sweep_axis ay;
+    int first;
+    int last;
+
+    *contact = (t_contact){1, 0, 0, 0, 0};
+    sweep_axis_init(&ax, box->x, box->width, dx, grid->width);
+    sweep_axis_init(&ay, box->y, box->height, dy, grid->height);
+    sweep_axis_next(&ax);
+    sweep_axis_next(&ay);
+    while (ax.next < 1 || ay.next < 1) {
+        // Ties go to x first; the y crossing then tests the new column too,
+        // so the diagonal corner cell is not missed
+        if (ax.next <= ay.next) {
+            double t = ax.next;
+
+            ax.lead += ax.step;
+            sweep_axis_span(&ay, t, &first, &last);
+            if (grid_column_solid(grid, clamp_cell(ax.lead, grid->width), first, last)) {
+                *contact = (t_contact){t, -ax.step, 0, 0, dy * (1 - t)};
+                return 1;
+            }
+            sweep_axis_next(&ax);
+        } else {
+            double t = ay.next;
+
+            ay.lead += ay.step;
+            sweep_axis_span(&ax, t, &first, &last);
+            if (grid_row_solid(grid, clamp_cell(ay.lead, grid->height), first, last)) {
+                *contact = (t_contact){t, 0, -ay.step, dx * (1 - t), 0};
+                return 1;
+            }
+            sweep_axis_next(&ay);
+        }
+    }
+    return 0;
+}
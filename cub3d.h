@@ -0,0 +1,650 @@
+#ifndef CUB3D_H
+# define CUB3D_H
+
+#include "include/MLX42/MLX42.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#define TILE_SIZE 32
+#define FOV 80
+#define PI 3.14159265358979323846
+#define MAX_SCREEN_WIDTH 1920
+#define MAX_SCREEN_HEIGHT 1080
+#define RAY_PACKET 8
+#define GRID_LEVELS 2
+#define GRID_BLOCK_SHIFT 3
+#define RENDER_STRIP 64
+// Angular slots in the caster's ray ring, a power of two
+#define RING_SLOTS 32768
+#define TEXTURE_MAX_SIZE 4096
+#define TEXTURE_MAX_LEVELS 13
+// Binary angle units to the turn, a power of two
+#define ANGLE_UNITS 65536
+#define ANGLE_QUARTER (ANGLE_UNITS / 4)
+// Simulation steps per second; movement speeds are per step
+#define SIM_RATE 60
+// Most steps one loop tick may run to catch up; a longer stall drops the
+// rest instead of freezing the window while the simulation catches up
+#define SIM_MAX_STEPS 8
+// How far, in world pixels, a box may sit past a cell edge in collide_move
+// and still count as only touching the cell: rounding can leave a body that
+// was stopped against a wall a hair inside it, and that must not let the
+// next move skip the wall's cells
+#define COLLIDE_EPSILON 1e-6
+
+// The map as one contiguous row-major byte array inside a one-cell wall
+// border: cell (x, y) is cells[y * stride + x] for x in [-1, width] and y in
+// [-1, height]. A ray that starts inside the map always stops at the border,
+// so traversal needs no bounds tests.
+// solid holds one bit per cell (set for walls) over the same bordered area,
+// solid_words 64-bit words per row; hot-path wall tests go through it, the
+// bytes stay the source of truth for what each cell is. transposed holds
+// the same bits column by column (transposed_words words per column), so a
+// run of cells down a column is a few word tests too.
+// occupied[level] is a coarser bitmap over the same bordered area, one bit
+// per block of 8x8 (level 0) or 64x64 (level 1) cells, set when the block
+// holds any wall; traversal jumps across clear blocks in one step.
+typedef struct s_grid
+{
+    char *data;
+    char *cells;
+    uint64_t *solid;
+    int solid_words;
+    uint64_t *transposed;
+    int transposed_words;
+    uint64_t *occupied[GRID_LEVELS];
+    int occupied_words[GRID_LEVELS];
+    int width;
+    int height;
+    int stride;
+    uint32_t generation;
+} t_grid;
+
+static inline uint64_t bytes_load(const char *p)
+{
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// 0x80 in every byte of word equal to the byte c, 0 elsewhere (exact, no
+// carries between bytes)
+static inline uint64_t bytes_match(uint64_t word, char c)
+{
+    const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    uint64_t v = word ^ (0x0101010101010101ULL * (unsigned char)c);
+
+    return ~(((v & low7) + low7) | v | low7);
+}
+
+// Wall test for x in [-1, width], y in [-1, height]
+static inline int grid_solid(const t_grid *grid, int x, int y)
+{
+    unsigned int bit = x + 1;
+
+    return (grid->solid[(size_t)(y + 1) * grid->solid_words + (bit >> 6)] >> (bit & 63)) & 1;
+}
+
+// Whether any of bits first..last of a bitmap row is set: one masked word
+// test per 64 bits
+static inline int bits_any(const uint64_t *bits, unsigned int first, unsigned int last)
+{
+    uint64_t hit = 0;
+
+    for (unsigned int word = first >> 6; word <= last >> 6; word++) {
+        uint64_t mask = ~0ULL;
+
+        if (word == first >> 6)
+            mask &= ~0ULL << (first & 63);
+        if (word == last >> 6)
+            mask &= ~0ULL >> (63 - (last & 63));
+        hit |= bits[word] & mask;
+    }
+    return hit != 0;
+}
+
+// Whether any of cells x0..x1 of row y is a wall; all in [-1, width] and
+// [-1, height], x0 <= x1
+static inline int grid_row_solid(const t_grid *grid, int y, int x0, int x1)
+{
+    return bits_any(grid->solid + (size_t)(y + 1) * grid->solid_words, x0 + 1, x1 + 1);
+}
+
+// Whether any of cells y0..y1 of column x is a wall, from the transposed
+// bitmap; same ranges as grid_row_solid
+static inline int grid_column_solid(const t_grid *grid, int x, int y0, int y1)
+{
+    return bits_any(grid->transposed + (size_t)(x + 1) * grid->transposed_words, y0 + 1, y1 + 1);
+}
+
+// Whether the level block holding cell (x, y) has any wall in it
+static inline int grid_block_occupied(const t_grid *grid, int level, int x, int y)
+{
+    int shift = GRID_BLOCK_SHIFT * (level + 1);
+    unsigned int bit = (unsigned int)(x + 1) >> shift;
+    size_t row = (unsigned int)(y + 1) >> shift;
+
+    return (grid->occupied[level][row * grid->occupied_words[level] + (bit >> 6)] >> (bit & 63)) & 1;
+}
+
+// Angle in binary units, ANGLE_UNITS to the turn: wrapping round is the
+// integer overflow, and an angle is an index into the trig tables.
+typedef uint16_t t_angle;
+
+// sin and tan over the first quarter turn, one entry per unit and both ends
+// included, filled in at startup (trig.c)
+extern double g_angle_sin[ANGLE_QUARTER + 1];
+extern double g_angle_tan[ANGLE_QUARTER + 1];
+
+// Nearest binary angle, of any radian angle
+static inline t_angle angle_from_radians(double radians)
+{
+    double units = radians * (ANGLE_UNITS / (2 * PI));
+
+    return (t_angle)(int64_t)(units < 0 ? units - 0.5 : units + 0.5);
+}
+
+static inline double angle_to_radians(t_angle angle)
+{
+    return angle * (2 * PI / ANGLE_UNITS);
+}
+
+// The other quarters mirror the first one
+static inline double bam_sin(t_angle angle)
+{
+    unsigned int i = angle & (ANGLE_QUARTER - 1);
+    double v = g_angle_sin[angle & ANGLE_QUARTER ? ANGLE_QUARTER - i : i];
+
+    return angle & 2 * ANGLE_QUARTER ? -v : v;
+}
+
+static inline double bam_cos(t_angle angle)
+{
+    return bam_sin((t_angle)(angle + ANGLE_QUARTER));
+}
+
+// tan repeats every half turn and is odd about it
+static inline double bam_tan(t_angle angle)
+{
+    unsigned int i = angle & (2 * ANGLE_QUARTER - 1);
+
+    return i <= ANGLE_QUARTER ? g_angle_tan[i] : -g_angle_tan[2 * ANGLE_QUARTER - i];
+}
+
+// Trig on radian angles for the per-frame and per-step code. Built with
+// -DCUB3D_TRIG_TABLES these round the angle to binary units and look it
+// up, with no libm call; by default they are libm's.
+static inline double angle_sin(double radians)
+{
+#ifdef CUB3D_TRIG_TABLES
+    return bam_sin(angle_from_radians(radians));
+#else
+    return sin(radians);
+#endif
+}
+
+static inline double angle_cos(double radians)
+{
+#ifdef CUB3D_TRIG_TABLES
+    return bam_cos(angle_from_radians(radians));
+#else
+    return cos(radians);
+#endif
+}
+
+static inline double angle_tan(double radians)
+{
+#ifdef CUB3D_TRIG_TABLES
+    return bam_tan(angle_from_radians(radians));
+#else
+    return tan(radians);
+#endif
+}
+
+enum e_texture
+{
+    TEX_NO,
+    TEX_SO,
+    TEX_WE,
+    TEX_EA,
+    TEX_FLOOR,
+    TEX_CEILING,
+    TEX_SPRITE,
+    TEX_COUNT
+};
+
+// One mip level stored column-major in MLX pixel words, so a screen column
+// reads one contiguous run: texel (x, y) is texels[x * stride + y + 1]. Each
+// column has a guard copy of its end texels above and below (stride is
+// height + 2), so a sampler may overshoot by one texel either way.
+typedef struct s_mip
+{
+    uint32_t *texels;
+    int width;
+    int height;
+    int stride;
+} t_mip;
+
+// Wall texture with its mip chain: level 0 is the image, each next level
+// halves both sizes (down to 1) with a 2x2 box filter. All levels share one
+// allocation, owned by levels[0].
+typedef struct s_texture
+{
+    t_mip levels[TEXTURE_MAX_LEVELS];
+    int level_count;
+} t_texture;
+
+// Billboard sprites, one array per field so culling and sorting only stream
+// through what they use. x, y are world pixels; every sprite is one cell
+// wide and tall, standing on the floor like a wall slice.
+// The rest is per-frame scratch sized like the sprites: sprites_project
+// leaves the visible ones' depth, screen x and index, and order lists those
+// slots nearest first.
+typedef struct s_sprites
+{
+    float *x;
+    float *y;
+    int count;
+    int capacity;
+    float *depth;
+    float *screen_x;
+    uint32_t *index;
+    uint32_t *order;
+    uint32_t *keys;
+    uint32_t *scratch;
+    int visible;
+} t_sprites;
+
+// Everything a .cub file describes. Colors are 0xRRGGBBAA; the spawn cell
+// holds '0' once loaded and spawn_angle is in radians (0 = east, y down).
+// Each '2' in the map is a sprite standing in an open cell.
+// surfaces holds the textures once scene_load_textures has run. Floor and
+// ceiling are given either as a color or as a texture path; without a path
+// their texture stays empty (level_count 0) and the color is drawn.
+typedef struct s_scene
+{
+    char *textures[TEX_COUNT];
+    t_texture surfaces[TEX_COUNT];
+    uint32_t floor_color;
+    uint32_t ceiling_color;
+    t_grid grid;
+    t_sprites sprites;
+    int spawn_x;
+    int spawn_y;
+    float spawn_angle;
+} t_scene;
+
+// Casts RAY_PACKET rays sharing one origin, writing one distance, hit side
+// (0: an x grid line, 1: a y grid line) and wall cell per ray.
+typedef void (*t_packet_fn)(const t_grid *grid, double player_x, double player_y,
+                            const double *dir_x, const double *dir_y, double *dist, int *side,
+                            int *cell_x, int *cell_y);
+
+// Fills n pixels of a floor or ceiling row from mip, starting at texture
+// position u, v (cells, 16.16 fixed point) and stepping by du, dv per pixel.
+typedef void (*t_surface_fn)(uint32_t *dst, int n, const t_mip *mip,
+                             uint32_t u, uint32_t v, uint32_t du, uint32_t dv);
+
+// Draws rows rows of n sprite pixels from dst on, pitch pixels apart. Row r
+// pixel i is texels[(pos >> 16) + offsets[i]] with pos stepping by step
+// (16.16) per row; offsets runs on to n rounded up to 8, valid past n, so
+// vector kernels need no scalar tail. Sprites go nearest first over a strip
+// of up to 64 columns, and covered holds one bit per strip column for each
+// row, from the block's first row on; pixel i is bit shift + i. A pixel is
+// written only where its keep bit is set (the sprite is in front of the
+// wall), its covered bit is clear (no nearer sprite drew it) and the texel
+// has alpha_bit, the top bit of its alpha byte, set; it then sets its
+// covered bit.
+typedef struct s_sprite_block
+{
+    uint32_t *dst;
+    int pitch;
+    int rows;
+    int n;
+    const uint32_t *texels;
+    int pos;
+    int step;
+    const int32_t *offsets;
+    uint64_t keep;
+    uint64_t *covered;
+    int shift;
+    uint32_t alpha_bit;
+} t_sprite_block;
+
+typedef void (*t_sprite_fn)(const t_sprite_block *block);
+
+// Persistent worker pool: pool_run splits [0, count) into one contiguous
+// range per thread (the caller takes the first one) and returns once every
+// range is done.
+typedef void (*t_pool_fn)(void *ctx, int begin, int end);
+
+typedef struct s_pool
+{
+    pthread_t *threads;
+    int n_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;
+    int pending;
+    int stop;
+    t_pool_fn fn;
+    void *ctx;
+    int count;
+} t_pool;
+
+// Pixel word for a 0xRRGGBBAA color. MLX keeps the bytes in R, G, B, A order
+// whatever the host byte order, so this is a byte swap on little-endian.
+static inline uint32_t raster_word(uint32_t color)
+{
+    uint8_t bytes[4] = {color >> 24, color >> 16, color >> 8, color};
+    uint32_t word;
+
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+// Pixel rectangle [x0, x1) x [y0, y1), empty when x0 >= x1 or y0 >= y1.
+// Used to remember what was drawn on an overlay so only that gets cleared.
+typedef struct s_rect
+{
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} t_rect;
+
+static inline t_rect rect_empty(void)
+{
+    return (t_rect){INT_MAX, INT_MAX, INT_MIN, INT_MIN};
+}
+
+// Grows rect to cover the pixel at (x, y)
+static inline void rect_include(t_rect *rect, int x, int y)
+{
+    rect->x0 = x < rect->x0 ? x : rect->x0;
+    rect->y0 = y < rect->y0 ? y : rect->y0;
+    rect->x1 = x >= rect->x1 ? x + 1 : rect->x1;
+    rect->y1 = y >= rect->y1 ? y + 1 : rect->y1;
+}
+
+// View direction (unit length) and camera plane (perpendicular, length
+// tan(FOV / 2)). Column i of n looks along dir + plane * (2 * i / n - 1).
+typedef struct s_camera
+{
+    double dir_x;
+    double dir_y;
+    double plane_x;
+    double plane_y;
+} t_camera;
+
+// Hits of a batch of rays, one array per field so each consumer streams
+// only what it reads. dist is the perpendicular distance to the wall in
+// pixels, so the hit point is origin + dir * dist. cell_x, cell_y is the
+// wall cell, and side is 0 when the face lies on an x grid line (a west or
+// east face), 1 on a y grid line. u is where the hit falls across the face,
+// in [0, 1) along the world axis the face runs (so faces seen looking west
+// or south run against it), and wall the TEX_ index of the face's texture.
+typedef struct s_ray_batch
+{
+    double *dist;
+    int *cell_x;
+    int *cell_y;
+    int *side;
+    double *u;
+    int *wall;
+    int capacity;
+} t_ray_batch;
+
+// Face a ray along dir hits on side: a ray heading north sees the NO
+// texture, and so on
+static inline int ray_wall(int side, double dir_x, double dir_y)
+{
+    if (side)
+        return dir_y < 0 ? TEX_NO : TEX_SO;
+    return dir_x < 0 ? TEX_WE : TEX_EA;
+}
+
+// floor and ceil for cell coordinates; the library calls are slow without
+// SSE4.1, and these run several times per column
+static inline int cell_floor(double v)
+{
+    int i = (int)v;
+
+    return i - (v < i);
+}
+
+static inline int cell_ceil(double v)
+{
+    int i = (int)v;
+
+    return i + (v > i);
+}
+
+// Fills hit i of batch for a ray from origin along dir that stopped dist
+// away on side, in the wall cell given
+static inline void ray_batch_store(t_ray_batch *batch, int i, double origin_x, double origin_y,
+                                   double dir_x, double dir_y, double dist, int side,
+                                   int cell_x, int cell_y)
+{
+    // Hit point along the face in cells; its fraction is u
+    double along = side ? origin_x + dir_x * dist : origin_y + dir_y * dist;
+
+    batch->dist[i] = dist;
+    batch->cell_x[i] = cell_x;
+    batch->cell_y[i] = cell_y;
+    batch->side[i] = side;
+    batch->u[i] = along / TILE_SIZE - cell_floor(along / TILE_SIZE);
+    batch->wall[i] = ray_wall(side, dir_x, dir_y);
+}
+
+// Grid line a ray from the ring's origin hit: an x line for side 0, a y
+// line for side 1, crossed along cells along it. stamp tells whether the
+// slot was filled from the current origin.
+typedef struct s_ring_slot
+{
+    double along;
+    int line;
+    int side;
+    uint32_t stamp;
+} t_ring_slot;
+
+// Per-frame ray batch: batch holds one hit per screen column, filled by
+// caster_cast, for drawing and for anything else that wants to know what is
+// in view. Column i's ray runs along ray0 + i * ray_step; last_ray0 and
+// last_ray_step are the same for last frame's camera. zbuffer is batch.dist
+// under the name depth tests know it by.
+// ring remembers, by direction all around, which grid line rays from
+// ring_x, ring_y last hit (NULL when turned off), on the walls of grid
+// generation ring_generation. While the origin stays
+// put, a column whose slot is filled takes its hit from that line instead of
+// being cast again. Once it moves, with temporal set, each column first
+// tries the line it hit last frame, from last_x, last_y. recast lists the
+// columns that still needed casting and recast_count how many columns the
+// last frame cast. generation is the grid's as of the last frame, so
+// neither cache outlives a rebuild of the walls.
+// span and sprite_kernel are the texture kernels the view draws with and
+// mipmap whether it samples mipmaps, all settled once by caster_init.
+// covered holds one sprite coverage mask of rows words per pool thread.
+typedef struct s_caster
+{
+    t_pool *pool;
+    t_packet_fn packet;
+    t_surface_fn span;
+    t_sprite_fn sprite_kernel;
+    int mipmap;
+    t_ray_batch batch;
+    const double *zbuffer;
+    uint64_t *covered;
+    int *recast;
+    int capacity;
+    int rows;
+    int count;
+    int recast_count;
+    int temporal;
+    double last_x;
+    double last_y;
+    double last_ray0_x;
+    double last_ray0_y;
+    double last_ray_step_x;
+    double last_ray_step_y;
+    t_ring_slot *ring;
+    uint32_t ring_stamp;
+    double ring_x;
+    double ring_y;
+    uint32_t ring_generation;
+    const t_grid *grid;
+    uint32_t generation;
+    double origin_x;
+    double origin_y;
+    double ray0_x;
+    double ray0_y;
+    double ray_step_x;
+    double ray_step_y;
+} t_caster;
+
+// One frame of movement intent, each -1, 0 or 1: forward/back, left/right
+// strafe, and turn left/right
+typedef struct s_input
+{
+    int forward;
+    int sideways;
+    int turn;
+} t_input;
+
+// Axis-aligned box in world pixels covering [x, x + width) x [y, y + height)
+typedef struct s_box
+{
+    double x;
+    double y;
+    double width;
+    double height;
+} t_box;
+
+// Result of a swept move: time is the fraction of the move made before the
+// box touched a wall, normal_x, normal_y the wall face's outward normal (0, 0
+// when nothing was hit) and slide_x, slide_y what is left of the move along
+// that face
+typedef struct s_contact
+{
+    double time;
+    int normal_x;
+    int normal_y;
+    double slide_x;
+    double slide_y;
+} t_contact;
+
+// Where the view is drawn from: the player square's top-left corner in
+// minimap pixels and the view angle
+typedef struct s_pose
+{
+    double x;
+    double y;
+    double angle;
+} t_pose;
+
+// x_pos, y_pos is the top-left corner of the player square in minimap
+// pixels. mlx is NULL when running headless; the images are then plain
+// framebuffers that never reach a window.
+// The window loop steps the simulation at SIM_RATE: clock is the time it
+// last caught up to and lag the time not yet simulated. previous is the pose
+// before the last step, drawn the one on screen; redraw forces the next
+// frame to be drawn even if the pose has not changed.
+typedef struct s_player
+{
+    t_scene scene;
+    int size;
+    float direction_angle;
+    double x_pos;
+    double y_pos;
+    double reminder_x;
+    double reminder_y;
+    mlx_t *mlx;
+    mlx_image_t *view;
+    mlx_image_t *map;
+    mlx_image_t *img;
+    mlx_image_t *direction_ray;
+    t_rect ray_dirty;
+    t_caster caster;
+    double clock;
+    double lag;
+    t_pose previous;
+    t_pose drawn;
+    bool redraw;
+} t_player;
+
+float deg_to_radian(float deg);
+float normalize_angle(float angle);
+
+int create_dynamic_map(t_scene *scene);
+int grid_alloc(t_grid *grid, int width, int height, char fill);
+int grid_from_rows(t_grid *grid, const char *const *rows);
+void grid_seal_border(t_grid *grid);
+int grid_build_solid(t_grid *grid);
+void grid_destroy(t_grid *grid);
+
+int collide_point(const t_grid *grid, double x, double y);
+int collide_box(const t_grid *grid, const t_box *box);
+int collide_move(const t_grid *grid, const t_box *box, double dx, double dy, t_contact *contact);
+
+int scene_load(t_scene *scene, const char *path);
+int scene_load_textures(t_scene *scene);
+int texture_from_rgba(t_texture *tex, const uint8_t *rgba, int width, int height);
+int texture_flat(t_texture *tex, uint32_t color);
+void texture_destroy(t_texture *tex);
+void scene_destroy(t_scene *scene);
+
+double wall_distance(double pos_x, double pos_y, int map_x, int map_y,
+                     int side, double ray_dir_x, double ray_dir_y);
+double ray_line_hit(double origin_x, double origin_y, double dir_x, double dir_y, int side, int behind,
+                    double *along, int *cell);
+double cast_single_ray_distance(const t_grid *grid, double player_x, double player_y, double ray_dir_x, double ray_dir_y);
+double cast_single_ray_cell(const t_grid *grid, double player_x, double player_y, double ray_dir_x,
+                            double ray_dir_y, int *cell_x, int *cell_y, int *side);
+void cast_ray_batch(const t_grid *grid, const double *origin_x, const double *origin_y,
+                    const double *dir_x, const double *dir_y, int count, t_ray_batch *hits);
+int ray_batch_reserve(t_ray_batch *batch, int count);
+void ray_batch_destroy(t_ray_batch *batch);
+t_packet_fn dda_select_packet(void);
+
+t_surface_fn surface_select_span(void);
+
+t_pool *pool_create(int n_threads);
+void pool_run(t_pool *pool, t_pool_fn fn, void *ctx, int count);
+int pool_thread(const t_pool *pool);
+void pool_destroy(t_pool *pool);
+int pool_default_threads(void);
+
+void raster_span(mlx_image_t *img, int x0, int x1, int y, uint32_t color);
+void raster_rect(mlx_image_t *img, int x, int y, int width, int height, uint32_t color);
+void raster_line(mlx_image_t *img, int x0, int y0, int x1, int y1, uint32_t color);
+void raster_clear(mlx_image_t *img, t_rect *dirty);
+
+void player_update(t_player *player, const t_input *input);
+t_pose player_pose(const t_player *player);
+t_pose pose_lerp(const t_pose *from, const t_pose *to, double t);
+void render_frame(t_player *player, const t_pose *pose);
+
+mlx_image_t *headless_image(uint32_t width, uint32_t height);
+void headless_image_delete(mlx_image_t *img);
+int headless_save_png(const mlx_image_t *img, const char *path);
+int headless_run(t_player *player, int frames, const char *dump_dir);
+
+void camera_from_angle(t_camera *camera, double angle, double fov);
+int caster_init(t_caster *caster, int n_threads);
+int caster_reserve(t_caster *caster, int columns, int rows);
+void caster_cast(t_caster *caster, const t_grid *grid, double origin_x, double origin_y,
+                 const t_camera *camera, int count);
+void caster_destroy(t_caster *caster);
+
+int sprites_add(t_sprites *sprites, float x, float y);
+void sprites_project(t_sprites *sprites, const t_camera *camera, double origin_x, double origin_y,
+                     double focal, int width);
+t_sprite_fn sprite_select_kernel(void);
+void sprites_destroy(t_sprites *sprites);
+
+#endif
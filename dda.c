@@ -0,0 +1,776 @@
+#include "cub3d.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define DDA_HAVE_AVX2 1
+#endif
+
+// Distances along a ray, in multiples of the ray direction's length. Built
+// with -DCUB3D_DDA_FIXED they are 32.32 fixed point: crossings are then
+// summed and compared as integers, and the hit distance is the crossing
+// itself, so the loop has no floating point left in it. Each ray still
+// takes one reciprocal per axis to set up.
+#ifdef CUB3D_DDA_FIXED
+typedef int64_t t_dda_len;
+# define DDA_ONE 4294967296.0
+// Caps a step length at 2^16 cells: no crossing that far away is ever
+// reached before the border, and n * delta stays in range for any n a
+// 32767-cell map needs
+# define DDA_NEVER 65536.0
+#else
+typedef double t_dda_len;
+# define DDA_ONE 1.0
+// Stands in for 1 / 0 as the step length along an axis the ray is parallel to
+# define DDA_NEVER 1e30
+#endif
+
+// Distance along the ray to the face of the wall cell it hit, in pixels
+double wall_distance(double pos_x, double pos_y, int map_x, int map_y,
+                     int side, double ray_dir_x, double ray_dir_y)
+{
+    int step_x = ray_dir_x < 0 ? -1 : 1;
+    int step_y = ray_dir_y < 0 ? -1 : 1;
+    double wall_dist;
+
+    if (side == 0) {
+        wall_dist = (map_x - pos_x + (1 - step_x) / 2) / ray_dir_x;
+    } else {
+        wall_dist = (map_y - pos_y + (1 - step_y) / 2) / ray_dir_y;
+    }
+    return wall_dist * TILE_SIZE;
+}
+
+// One ray's DDA state. The n-th crossing of an x grid line is at distance
+// side0_x + n * delta_x (likewise for y); side_x and side_y always hold that
+// closed form for the next crossing instead of a running sum, so a ray that
+// jumps across a block lands on exactly the state stepping would reach.
+typedef struct s_ray
+{
+    t_dda_len side0_x;
+    t_dda_len side0_y;
+    t_dda_len delta_x;
+    t_dda_len delta_y;
+    double inv_delta_x;
+    double inv_delta_y;
+    t_dda_len side_x;
+    t_dda_len side_y;
+    int step_x;
+    int step_y;
+    int start_x;
+    int start_y;
+    int map_x;
+    int map_y;
+    int n_x;
+    int n_y;
+} t_ray;
+
+// Length in cells as a t_dda_len, capped at DDA_NEVER
+static inline t_dda_len dda_len(double cells)
+{
+#ifdef CUB3D_DDA_FIXED
+    return (t_dda_len)((cells < DDA_NEVER ? cells : DDA_NEVER) * DDA_ONE + 0.5);
+#else
+    return cells;
+#endif
+}
+
+__attribute__((always_inline))
+static inline void ray_init(t_ray *ray, double pos_x, double pos_y, double ray_dir_x, double ray_dir_y)
+{
+    // Current map position
+    ray->map_x = (int)pos_x;
+    ray->map_y = (int)pos_y;
+    ray->start_x = ray->map_x;
+    ray->start_y = ray->map_y;
+
+    // Distance ray travels for each unit step; an axis the ray never crosses
+    // gets a huge finite one, as 0 * inf would give NaN crossings
+    double delta_x = ray_dir_x == 0 ? DDA_NEVER : fabs(1.0 / ray_dir_x);
+    double delta_y = ray_dir_y == 0 ? DDA_NEVER : fabs(1.0 / ray_dir_y);
+
+    ray->delta_x = dda_len(delta_x);
+    ray->delta_y = dda_len(delta_y);
+    ray->inv_delta_x = fabs(ray_dir_x) / DDA_ONE;
+    ray->inv_delta_y = fabs(ray_dir_y) / DDA_ONE;
+
+    // Step direction and initial distances
+    if (ray_dir_x < 0) {
+        ray->step_x = -1;
+        ray->side0_x = dda_len((pos_x - ray->map_x) * delta_x);
+    } else {
+        ray->step_x = 1;
+        ray->side0_x = dda_len((ray->map_x + 1.0 - pos_x) * delta_x);
+    }
+
+    if (ray_dir_y < 0) {
+        ray->step_y = -1;
+        ray->side0_y = dda_len((pos_y - ray->map_y) * delta_y);
+    } else {
+        ray->step_y = 1;
+        ray->side0_y = dda_len((ray->map_y + 1.0 - pos_y) * delta_y);
+    }
+    ray->n_x = 0;
+    ray->n_y = 0;
+    ray->side_x = ray->side0_x;
+    ray->side_y = ray->side0_y;
+}
+
+// One DDA step; returns its side (0 = x, 1 = y)
+static inline int ray_step(t_ray *ray)
+{
+    if (ray->side_x < ray->side_y) {
+        ray->n_x++;
+        ray->map_x += ray->step_x;
+        ray->side_x = ray->side0_x + ray->n_x * ray->delta_x;
+        return 0;
+    }
+    ray->n_y++;
+    ray->map_y += ray->step_y;
+    ray->side_y = ray->side0_y + ray->n_y * ray->delta_y;
+    return 1;
+}
+
+static inline int crossing_past(t_dda_len side0, t_dda_len delta, int n, t_dda_len t, int ties)
+{
+    t_dda_len crossing = side0 + n * delta;
+
+    return ties ? !(crossing < t) : t < crossing;
+}
+
+// First n in [from, limit] whose crossing side0 + n * delta is past t, or at
+// or past it with ties. Crossings only grow with n, and (t - side0) / delta
+// is off from the answer by well under one step, so starting right after it
+// the fix-up loops almost never run.
+static inline int first_crossing_past(t_dda_len side0, t_dda_len delta, double inv_delta,
+                                      int from, int limit, t_dda_len t, int ties)
+{
+    double guess = (t - side0) * inv_delta + 1;
+    int n = guess < from ? from : guess > limit ? limit : (int)guess;
+
+    while (n > from && crossing_past(side0, delta, n - 1, t, ties))
+        n--;
+    while (n < limit && !crossing_past(side0, delta, n, t, ties))
+        n++;
+    return n;
+}
+
+// Index n of the crossing that takes the ray out of the given block along
+// one axis: crossing n moves the ray onto cell start + (n + 1) * step.
+static inline int block_exit(int block, int shift, int step, int start)
+{
+    // Block edge in the step direction, back from bitmap to map coordinates
+    int last = (step > 0 ? ((block + 1) << shift) - 1 : block << shift) - 1;
+
+    return (last - start) * step;
+}
+
+// Puts the ray on the cell it enters through crossing exit on side, at
+// distance t; the other axis' crossing count is at most limit.
+__attribute__((always_inline))
+static inline void ray_settle(t_ray *ray, int side, int exit, int limit, t_dda_len t)
+{
+    if (side == 0) {
+        ray->n_x = exit + 1;
+        ray->n_y = first_crossing_past(ray->side0_y, ray->delta_y, ray->inv_delta_y, ray->n_y, limit, t, 0);
+    } else {
+        ray->n_y = exit + 1;
+        ray->n_x = first_crossing_past(ray->side0_x, ray->delta_x, ray->inv_delta_x, ray->n_x, limit, t, 1);
+    }
+    ray->map_x = ray->start_x + ray->n_x * ray->step_x;
+    ray->map_y = ray->start_y + ray->n_y * ray->step_y;
+    ray->side_x = ray->side0_x + ray->n_x * ray->delta_x;
+    ray->side_y = ray->side0_y + ray->n_y * ray->delta_y;
+}
+
+// Walks the ray across wall-free blocks, 64x64 ones wherever those are clear
+// and 8x8 ones elsewhere, up to the first cell of the next 8x8 block holding
+// a wall; returns the side of that last step. The cell's own 8x8 block must
+// be clear.
+// The walk is a DDA over block faces. The DDA crosses x line i before y line
+// j exactly when side0_x + i * delta_x < side0_y + j * delta_y, so comparing
+// the same closed forms for the block faces visits the blocks the cell by
+// cell loop would, and the cell stepping resumes from the state that loop
+// would have reached.
+__attribute__((always_inline))
+static inline int ray_skip(const t_grid *grid, t_ray *ray)
+{
+    int level = !grid_block_occupied(grid, 1, ray->map_x, ray->map_y);
+    int shift = GRID_BLOCK_SHIFT * (level + 1);
+    int block_x = (ray->map_x + 1) >> shift;
+    int block_y = (ray->map_y + 1) >> shift;
+    int exit_x = block_exit(block_x, shift, ray->step_x, ray->start_x);
+    int exit_y = block_exit(block_y, shift, ray->step_y, ray->start_y);
+    t_dda_len t_x = ray->side0_x + exit_x * ray->delta_x;
+    t_dda_len t_y = ray->side0_y + exit_y * ray->delta_y;
+
+    for (;;) {
+        int side = !(t_x < t_y);
+
+        if (side == 0)
+            block_x += ray->step_x;
+        else
+            block_y += ray->step_y;
+        // Any cell of the block will do for the occupancy lookups
+        int cell_x = (block_x << shift) - 1;
+        int cell_y = (block_y << shift) - 1;
+
+        if (!grid_block_occupied(grid, level, cell_x, cell_y)) {
+            if (level == 0 && !grid_block_occupied(grid, 1, cell_x, cell_y)) {
+                level = 1;
+                shift += GRID_BLOCK_SHIFT;
+                block_x >>= GRID_BLOCK_SHIFT;
+                block_y >>= GRID_BLOCK_SHIFT;
+                exit_x = block_exit(block_x, shift, ray->step_x, ray->start_x);
+                exit_y = block_exit(block_y, shift, ray->step_y, ray->start_y);
+                t_x = ray->side0_x + exit_x * ray->delta_x;
+                t_y = ray->side0_y + exit_y * ray->delta_y;
+            } else if (side == 0) {
+                exit_x += 1 << shift;
+                t_x = ray->side0_x + exit_x * ray->delta_x;
+            } else {
+                exit_y += 1 << shift;
+                t_y = ray->side0_y + exit_y * ray->delta_y;
+            }
+            continue;
+        }
+        if (side == 0)
+            ray_settle(ray, 0, exit_x, exit_y, t_x);
+        else
+            ray_settle(ray, 1, exit_y, exit_x, t_y);
+        if (level == 0)
+            return side;
+
+        // Entered a 64x64 block with walls: go on with its 8x8 blocks
+        level = 0;
+        shift = GRID_BLOCK_SHIFT;
+        if (grid_block_occupied(grid, 0, ray->map_x, ray->map_y))
+            return side;
+        block_x = (ray->map_x + 1) >> shift;
+        block_y = (ray->map_y + 1) >> shift;
+        exit_x = block_exit(block_x, shift, ray->step_x, ray->start_x);
+        exit_y = block_exit(block_y, shift, ray->step_y, ray->start_y);
+        t_x = ray->side0_x + exit_x * ray->delta_x;
+        t_y = ray->side0_y + exit_y * ray->delta_y;
+    }
+}
+
+// Runs the ray from its current state to the first wall and returns the
+// side it was hit on. skip is a constant at every call site, so each caller
+// gets a loop without the unused branch.
+__attribute__((always_inline))
+static inline int ray_trace(const t_grid *grid, t_ray *ray, int skip)
+{
+    int side;
+    int clear = skip && !grid_block_occupied(grid, 0, ray->map_x, ray->map_y);
+
+    // The grid border guarantees a wall before the ray leaves; cells in a
+    // clear block need no wall test
+    for (;;) {
+        side = clear ? ray_skip(grid, ray) : ray_step(ray);
+        clear = skip && !grid_block_occupied(grid, 0, ray->map_x, ray->map_y);
+        if (!clear && grid_solid(grid, ray->map_x, ray->map_y))
+            return side;
+    }
+}
+
+// Distance in pixels to the wall the traced ray stands in, hit on side. In
+// fixed point that is the crossing the ray entered it through, the one
+// before the next on that axis.
+__attribute__((always_inline))
+static inline double ray_distance(const t_ray *ray, int side, double pos_x, double pos_y,
+                                  double ray_dir_x, double ray_dir_y)
+{
+#ifdef CUB3D_DDA_FIXED
+    t_dda_len crossing = side == 0 ? ray->side_x - ray->delta_x : ray->side_y - ray->delta_y;
+
+    (void)pos_x;
+    (void)pos_y;
+    (void)ray_dir_x;
+    (void)ray_dir_y;
+    return crossing * (TILE_SIZE / DDA_ONE);
+#else
+    return wall_distance(pos_x, pos_y, ray->map_x, ray->map_y, side, ray_dir_x, ray_dir_y);
+#endif
+}
+
+// Returns the distance to the first wall and stores the side it was hit on
+// (0: an x grid line, 1: a y grid line) and, without NULL, the wall's cell
+__attribute__((always_inline))
+static inline double ray_cast(const t_grid *grid, double player_x, double player_y,
+                              double ray_dir_x, double ray_dir_y, int skip, int *side_out,
+                              int *cell_x, int *cell_y)
+{
+    // Convert to map coordinates
+    double pos_x = player_x / TILE_SIZE;
+    double pos_y = player_y / TILE_SIZE;
+    t_ray ray;
+    int side;
+
+    ray_init(&ray, pos_x, pos_y, ray_dir_x, ray_dir_y);
+    side = ray_trace(grid, &ray, skip);
+    *side_out = side;
+    if (cell_x) {
+        *cell_x = ray.map_x;
+        *cell_y = ray.map_y;
+    }
+    return ray_distance(&ray, side, pos_x, pos_y, ray_dir_x, ray_dir_y);
+}
+
+// Where a ray from origin, in pixels, along dir enters the wall cell behind
+// grid line behind of side (an x index for side 0, a y index for side 1),
+// for callers that already know which line a ray ends on. Returns the
+// distance a cast ending there reports, 0 when the line is not ahead, and
+// stores where along the line the ray crosses it, in cells, and the hit
+// cell's other coordinate. Both come out of the cast's own arithmetic: in
+// fixed point the ray is settled onto that crossing like a block skip
+// would, so the cell is the one the DDA steps into even at a corner.
+double ray_line_hit(double origin_x, double origin_y, double dir_x, double dir_y, int side, int behind,
+                    double *along, int *cell)
+{
+    double pos_x = origin_x / TILE_SIZE;
+    double pos_y = origin_y / TILE_SIZE;
+    double dist;
+
+#ifdef CUB3D_DDA_FIXED
+    t_ray ray;
+
+    ray_init(&ray, pos_x, pos_y, dir_x, dir_y);
+    int n = side == 0 ? (behind - ray.start_x) * ray.step_x : (behind - ray.start_y) * ray.step_y;
+    if (n < 1) {
+        *along = 0;
+        *cell = 0;
+        return 0;
+    }
+    if (side == 0)
+        ray_settle(&ray, 0, n - 1, INT_MAX, ray.side0_x + (n - 1) * ray.delta_x);
+    else
+        ray_settle(&ray, 1, n - 1, INT_MAX, ray.side0_y + (n - 1) * ray.delta_y);
+    dist = ray_distance(&ray, side, pos_x, pos_y, dir_x, dir_y);
+    *cell = side == 0 ? ray.map_y : ray.map_x;
+#else
+    dist = wall_distance(pos_x, pos_y, side == 0 ? behind : 0, side == 0 ? 0 : behind, side, dir_x, dir_y);
+#endif
+    *along = (side == 0 ? origin_y + dir_y * dist : origin_x + dir_x * dist) / TILE_SIZE;
+#ifndef CUB3D_DDA_FIXED
+    *cell = *along >= 0 && *along < INT_MAX ? (int)*along : -1;
+#endif
+    return dist;
+}
+
+double cast_single_ray_distance(const t_grid *grid, double player_x, double player_y, double ray_dir_x, double ray_dir_y)
+{
+    int side;
+
+    return ray_cast(grid, player_x, player_y, ray_dir_x, ray_dir_y, 1, &side, NULL, NULL);
+}
+
+double cast_single_ray_cell(const t_grid *grid, double player_x, double player_y, double ray_dir_x,
+                            double ray_dir_y, int *cell_x, int *cell_y, int *side)
+{
+    return ray_cast(grid, player_x, player_y, ray_dir_x, ray_dir_y, 1, side, cell_x, cell_y);
+}
+
+// Casts count rays, each from its own origin in pixels, and fills hits with
+// all there is to know about where each stopped, so rendering, line of
+// sight and sound can share one traversal instead of tracing again. hits
+// must hold count rays (ray_batch_reserve).
+void cast_ray_batch(const t_grid *grid, const double *origin_x, const double *origin_y,
+                    const double *dir_x, const double *dir_y, int count, t_ray_batch *hits)
+{
+    for (int i = 0; i < count; i++) {
+        int side;
+        int cell_x;
+        int cell_y;
+        double dist = ray_cast(grid, origin_x[i], origin_y[i], dir_x[i], dir_y[i], 1, &side, &cell_x, &cell_y);
+
+        ray_batch_store(hits, i, origin_x[i], origin_y[i], dir_x[i], dir_y[i], dist, side, cell_x, cell_y);
+    }
+}
+
+int ray_batch_reserve(t_ray_batch *batch, int count)
+{
+    if (count <= batch->capacity)
+        return 0;
+    double *dist = realloc(batch->dist, count * sizeof(double));
+    if (!dist)
+        return -1;
+    batch->dist = dist;
+    int *cell_x = realloc(batch->cell_x, count * sizeof(int));
+    if (!cell_x)
+        return -1;
+    batch->cell_x = cell_x;
+    int *cell_y = realloc(batch->cell_y, count * sizeof(int));
+    if (!cell_y)
+        return -1;
+    batch->cell_y = cell_y;
+    int *side = realloc(batch->side, count * sizeof(int));
+    if (!side)
+        return -1;
+    batch->side = side;
+    double *u = realloc(batch->u, count * sizeof(double));
+    if (!u)
+        return -1;
+    batch->u = u;
+    int *wall = realloc(batch->wall, count * sizeof(int));
+    if (!wall)
+        return -1;
+    batch->wall = wall;
+    batch->capacity = count;
+    return 0;
+}
+
+void ray_batch_destroy(t_ray_batch *batch)
+{
+    free(batch->dist);
+    free(batch->cell_x);
+    free(batch->cell_y);
+    free(batch->side);
+    free(batch->u);
+    free(batch->wall);
+    memset(batch, 0, sizeof(t_ray_batch));
+}
+
+static void cast_ray_packet_scalar(const t_grid *grid, double player_x, double player_y,
+                                   const double *dir_x, const double *dir_y, double *dist, int *side,
+                                   int *cell_x, int *cell_y)
+{
+    for (int lane = 0; lane < RAY_PACKET; lane++)
+        dist[lane] = ray_cast(grid, player_x, player_y, dir_x[lane], dir_y[lane], 1, &side[lane],
+                              &cell_x[lane], &cell_y[lane]);
+}
+
+static void cast_ray_packet_scalar_plain(const t_grid *grid, double player_x, double player_y,
+                                         const double *dir_x, const double *dir_y, double *dist, int *side,
+                                         int *cell_x, int *cell_y)
+{
+    for (int lane = 0; lane < RAY_PACKET; lane++)
+        dist[lane] = ray_cast(grid, player_x, player_y, dir_x[lane], dir_y[lane], 0, &side[lane],
+                              &cell_x[lane], &cell_y[lane]);
+}
+
+#ifdef DDA_HAVE_AVX2
+
+# define DDA_CHUNK 8
+
+#ifdef CUB3D_DDA_FIXED
+
+// Four lanes of DDA state, the vector form of t_ray. Crossings are 32.32
+// integers like the scalar loop's, so adding delta on each step lands on
+// exactly the closed form side0 + n * delta and the lanes need no side0.
+typedef struct s_lanes
+{
+    __m256i delta_x;
+    __m256i delta_y;
+    __m256i side_x;
+    __m256i side_y;
+    __m256i n_x;
+    __m256i n_y;
+    __m256i step_x;
+    __m256i step_y;
+    __m256i map_x;
+    __m256i map_y;
+} t_lanes;
+
+typedef long long t_lane_count;
+
+#else
+
+// Four lanes of DDA state, the vector form of t_ray. Cells are 64-bit lane
+// integers so they line up with the double-precision side distances.
+typedef struct s_lanes
+{
+    __m256d side0_x;
+    __m256d side0_y;
+    __m256d delta_x;
+    __m256d delta_y;
+    __m256d side_x;
+    __m256d side_y;
+    __m256d n_x;
+    __m256d n_y;
+    __m256i step_x;
+    __m256i step_y;
+    __m256i map_x;
+    __m256i map_y;
+} t_lanes;
+
+typedef double t_lane_count;
+
+#endif
+
+// Lane state as of the start of a chunk, in plain arrays
+typedef struct s_lane_state
+{
+    long long map_x[RAY_PACKET];
+    long long map_y[RAY_PACKET];
+    t_lane_count n_x[RAY_PACKET];
+    t_lane_count n_y[RAY_PACKET];
+} t_lane_state;
+
+#ifdef CUB3D_DDA_FIXED
+
+__attribute__((target("avx2"), always_inline))
+static inline void lanes_store(const t_lanes *l, t_lane_state *state, int first)
+{
+    _mm256_storeu_si256((__m256i *)&state->map_x[first], l->map_x);
+    _mm256_storeu_si256((__m256i *)&state->map_y[first], l->map_y);
+    _mm256_storeu_si256((__m256i *)&state->n_x[first], l->n_x);
+    _mm256_storeu_si256((__m256i *)&state->n_y[first], l->n_y);
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline void lanes_init(t_lanes *l, const t_ray *r)
+{
+    l->delta_x = _mm256_setr_epi64x(r[0].delta_x, r[1].delta_x, r[2].delta_x, r[3].delta_x);
+    l->delta_y = _mm256_setr_epi64x(r[0].delta_y, r[1].delta_y, r[2].delta_y, r[3].delta_y);
+    l->side_x = _mm256_setr_epi64x(r[0].side0_x, r[1].side0_x, r[2].side0_x, r[3].side0_x);
+    l->side_y = _mm256_setr_epi64x(r[0].side0_y, r[1].side0_y, r[2].side0_y, r[3].side0_y);
+    l->n_x = _mm256_setzero_si256();
+    l->n_y = _mm256_setzero_si256();
+    l->step_x = _mm256_setr_epi64x(r[0].step_x, r[1].step_x, r[2].step_x, r[3].step_x);
+    l->step_y = _mm256_setr_epi64x(r[0].step_y, r[1].step_y, r[2].step_y, r[3].step_y);
+    l->map_x = _mm256_setr_epi64x(r[0].map_x, r[1].map_x, r[2].map_x, r[3].map_x);
+    l->map_y = _mm256_setr_epi64x(r[0].map_y, r[1].map_y, r[2].map_y, r[3].map_y);
+}
+
+// One DDA step on all four lanes; returns the side mask (all ones = y step).
+// The x-first mask is -1 where set, so subtracting it counts the step.
+__attribute__((target("avx2"), always_inline))
+static inline __m256i lanes_step(t_lanes *l)
+{
+    __m256i take_x = _mm256_cmpgt_epi64(l->side_y, l->side_x);
+    __m256i take_y = _mm256_xor_si256(take_x, _mm256_set1_epi64x(-1));
+
+    l->n_x = _mm256_sub_epi64(l->n_x, take_x);
+    l->n_y = _mm256_sub_epi64(l->n_y, take_y);
+    l->side_x = _mm256_add_epi64(l->side_x, _mm256_and_si256(l->delta_x, take_x));
+    l->side_y = _mm256_add_epi64(l->side_y, _mm256_and_si256(l->delta_y, take_y));
+    l->map_x = _mm256_add_epi64(l->map_x, _mm256_and_si256(l->step_x, take_x));
+    l->map_y = _mm256_add_epi64(l->map_y, _mm256_and_si256(l->step_y, take_y));
+    return take_y;
+}
+
+#else
+
+__attribute__((target("avx2"), always_inline))
+static inline void lanes_store(const t_lanes *l, t_lane_state *state, int first)
+{
+    _mm256_storeu_si256((__m256i *)&state->map_x[first], l->map_x);
+    _mm256_storeu_si256((__m256i *)&state->map_y[first], l->map_y);
+    _mm256_storeu_pd(&state->n_x[first], l->n_x);
+    _mm256_storeu_pd(&state->n_y[first], l->n_y);
+}
+
+// The lanes start from the scalar setup of each ray, so both kernels work
+// from identical values
+__attribute__((target("avx2"), always_inline))
+static inline void lanes_init(t_lanes *l, const t_ray *r)
+{
+    l->side0_x = _mm256_setr_pd(r[0].side0_x, r[1].side0_x, r[2].side0_x, r[3].side0_x);
+    l->side0_y = _mm256_setr_pd(r[0].side0_y, r[1].side0_y, r[2].side0_y, r[3].side0_y);
+    l->delta_x = _mm256_setr_pd(r[0].delta_x, r[1].delta_x, r[2].delta_x, r[3].delta_x);
+    l->delta_y = _mm256_setr_pd(r[0].delta_y, r[1].delta_y, r[2].delta_y, r[3].delta_y);
+    l->side_x = l->side0_x;
+    l->side_y = l->side0_y;
+    l->n_x = _mm256_setzero_pd();
+    l->n_y = _mm256_setzero_pd();
+    l->step_x = _mm256_setr_epi64x(r[0].step_x, r[1].step_x, r[2].step_x, r[3].step_x);
+    l->step_y = _mm256_setr_epi64x(r[0].step_y, r[1].step_y, r[2].step_y, r[3].step_y);
+    l->map_x = _mm256_setr_epi64x(r[0].map_x, r[1].map_x, r[2].map_x, r[3].map_x);
+    l->map_y = _mm256_setr_epi64x(r[0].map_y, r[1].map_y, r[2].map_y, r[3].map_y);
+}
+
+// One DDA step on all four lanes; returns the side mask (all ones = y step).
+__attribute__((target("avx2"), always_inline))
+static inline __m256i lanes_step(t_lanes *l)
+{
+    __m256d x_first = _mm256_cmp_pd(l->side_x, l->side_y, _CMP_LT_OQ);
+    __m256i take_x = _mm256_castpd_si256(x_first);
+    __m256d one = _mm256_set1_pd(1.0);
+
+    l->n_x = _mm256_add_pd(l->n_x, _mm256_and_pd(one, x_first));
+    l->n_y = _mm256_add_pd(l->n_y, _mm256_andnot_pd(x_first, one));
+    l->side_x = _mm256_add_pd(l->side0_x, _mm256_mul_pd(l->n_x, l->delta_x));
+    l->side_y = _mm256_add_pd(l->side0_y, _mm256_mul_pd(l->n_y, l->delta_y));
+    l->map_x = _mm256_add_epi64(l->map_x, _mm256_and_si256(l->step_x, take_x));
+    l->map_y = _mm256_add_epi64(l->map_y, _mm256_andnot_si256(take_x, l->step_y));
+    return _mm256_xor_si256(take_x, _mm256_set1_epi64x(-1));
+}
+
+#endif
+
+// Bit index of every lane's cell in grid->solid. Lanes keep stepping for the
+// rest of the chunk after they hit, possibly through the border, so the index
+// is clamped to the bitmap; a lane's reads past its first wall are never
+// looked at.
+__attribute__((target("avx2"), always_inline))
+static inline __m256i lanes_bit(const t_lanes *l, __m256i bit_stride, __m256i origin, __m256i last)
+{
+    __m256i bit = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epi32(l->map_y, bit_stride), l->map_x), origin);
+
+    bit = _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), bit), bit);
+    return _mm256_blendv_epi8(bit, last, _mm256_cmpgt_epi64(bit, last));
+}
+
+// Bit s set in each 64-bit lane whose recorded cell is a wall
+__attribute__((target("avx2"), always_inline))
+static inline __m256i lanes_solid(const t_grid *grid, const long long *bits, int s)
+{
+    __m256i bit = _mm256_loadu_si256((const __m256i *)bits);
+    __m256i words = _mm256_i64gather_epi64((const long long *)grid->solid, _mm256_srli_epi64(bit, 6), 8);
+    __m256i solid = _mm256_and_si256(_mm256_srlv_epi64(words, _mm256_and_si256(bit, _mm256_set1_epi64x(63))),
+                                     _mm256_set1_epi64x(1));
+
+    return _mm256_sll_epi64(solid, _mm_cvtsi32_si128(s));
+}
+
+// Hands every active lane that starts the chunk in a wall-free block over to
+// the scalar loop, which skips across open space far better than stepping
+// eight lanes in lockstep does, and retires it at its wall.
+__attribute__((target("avx2"), always_inline))
+static inline void lanes_finish_open(const t_grid *grid, t_ray *rays, const t_lane_state *state,
+                                     int *active, int *hit_side)
+{
+    for (int lane = 0; lane < RAY_PACKET; lane++) {
+        t_ray *ray = &rays[lane];
+
+        if (!(*active & (1 << lane))
+            || grid_block_occupied(grid, 0, state->map_x[lane], state->map_y[lane]))
+            continue;
+        ray->map_x = state->map_x[lane];
+        ray->map_y = state->map_y[lane];
+        ray->n_x = state->n_x[lane];
+        ray->n_y = state->n_y[lane];
+        ray->side_x = ray->side0_x + ray->n_x * ray->delta_x;
+        ray->side_y = ray->side0_y + ray->n_y * ray->delta_y;
+        hit_side[lane] = ray_trace(grid, ray, 1);
+        *active &= ~(1 << lane);
+    }
+}
+
+// Eight rays from the same origin, stepped as two interleaved groups of four
+// so the two dependency chains overlap. The stepping is branch-free and runs
+// DDA_CHUNK steps ahead, recording each lane's cell and step side; the
+// recorded cells' solid bits are then gathered in one pass and each lane
+// retires at its first wall. With skip, lanes that reach open space finish
+// in the scalar loop instead. Every lane takes the same x/y decisions as the
+// scalar loop, so hit cells and distances match it bit for bit.
+__attribute__((target("avx2"), always_inline))
+static inline void ray_packet_avx2(const t_grid *grid, double player_x, double player_y,
+                                   const double *dir_x, const double *dir_y, double *dist, int *side,
+                                   int *cell_x, int *cell_y, int skip)
+{
+    double pos_x = player_x / TILE_SIZE;
+    double pos_y = player_y / TILE_SIZE;
+    t_ray rays[RAY_PACKET];
+    t_lane_state state;
+    t_lanes lo, hi;
+    long long bits[DDA_CHUNK][RAY_PACKET];
+    unsigned char y_steps[DDA_CHUNK];
+    int hit_side[RAY_PACKET];
+    int active = (1 << RAY_PACKET) - 1;
+
+    long long bit_stride = (long long)grid->solid_words * 64;
+    __m256i stride = _mm256_set1_epi64x(bit_stride);
+    __m256i origin = _mm256_set1_epi64x(bit_stride + 1);
+    __m256i last = _mm256_set1_epi64x(bit_stride * (grid->height + 2) - 1);
+
+    for (int lane = 0; lane < RAY_PACKET; lane++)
+        ray_init(&rays[lane], pos_x, pos_y, dir_x[lane], dir_y[lane]);
+    lanes_init(&lo, rays);
+    lanes_init(&hi, rays + 4);
+    while (active) {
+        lanes_store(&lo, &state, 0);
+        lanes_store(&hi, &state, 4);
+        if (skip) {
+            lanes_finish_open(grid, rays, &state, &active, hit_side);
+            if (!active)
+                break;
+        }
+        for (int s = 0; s < DDA_CHUNK; s++) {
+            __m256i side_lo = lanes_step(&lo);
+            __m256i side_hi = lanes_step(&hi);
+
+            y_steps[s] = _mm256_movemask_pd(_mm256_castsi256_pd(side_lo))
+                | _mm256_movemask_pd(_mm256_castsi256_pd(side_hi)) << 4;
+            _mm256_storeu_si256((__m256i *)&bits[s][0], lanes_bit(&lo, stride, origin, last));
+            _mm256_storeu_si256((__m256i *)&bits[s][4], lanes_bit(&hi, stride, origin, last));
+        }
+
+        // Bit s of walls[lane] is set when that lane stood in a wall after step s
+        __m256i hits_lo = _mm256_setzero_si256();
+        __m256i hits_hi = _mm256_setzero_si256();
+        for (int s = 0; s < DDA_CHUNK; s++) {
+            hits_lo = _mm256_or_si256(hits_lo, lanes_solid(grid, &bits[s][0], s));
+            hits_hi = _mm256_or_si256(hits_hi, lanes_solid(grid, &bits[s][4], s));
+        }
+        unsigned long long walls[RAY_PACKET];
+        _mm256_storeu_si256((__m256i *)&walls[0], hits_lo);
+        _mm256_storeu_si256((__m256i *)&walls[4], hits_hi);
+
+        for (int lane = 0; lane < RAY_PACKET; lane++) {
+            unsigned int lane_walls = (unsigned int)walls[lane];
+            if (!(active & (1 << lane)) || !lane_walls)
+                continue;
+            // Replay the recorded sides up to the first wall to recover the cell
+            int first = __builtin_ctz(lane_walls);
+            int steps_y = 0;
+            for (int s = 0; s <= first; s++)
+                steps_y += (y_steps[s] >> lane) & 1;
+            int steps_x = first + 1 - steps_y;
+            t_ray *ray = &rays[lane];
+
+            ray->n_x = state.n_x[lane] + steps_x;
+            ray->n_y = state.n_y[lane] + steps_y;
+            ray->map_x = (int)state.map_x[lane] + steps_x * ray->step_x;
+            ray->map_y = (int)state.map_y[lane] + steps_y * ray->step_y;
+            ray->side_x = ray->side0_x + ray->n_x * ray->delta_x;
+            ray->side_y = ray->side0_y + ray->n_y * ray->delta_y;
+            hit_side[lane] = (y_steps[first] >> lane) & 1;
+            active &= ~(1 << lane);
+        }
+    }
+    for (int lane = 0; lane < RAY_PACKET; lane++) {
+        dist[lane] = ray_distance(&rays[lane], hit_side[lane], pos_x, pos_y, dir_x[lane], dir_y[lane]);
+        side[lane] = hit_side[lane];
+        cell_x[lane] = rays[lane].map_x;
+        cell_y[lane] = rays[lane].map_y;
+    }
+}
+
+__attribute__((target("avx2")))
+static void cast_ray_packet_avx2(const t_grid *grid, double player_x, double player_y,
+                                 const double *dir_x, const double *dir_y, double *dist, int *side,
+                                 int *cell_x, int *cell_y)
+{
+    ray_packet_avx2(grid, player_x, player_y, dir_x, dir_y, dist, side, cell_x, cell_y, 1);
+}
+
+__attribute__((target("avx2")))
+static void cast_ray_packet_avx2_plain(const t_grid *grid, double player_x, double player_y,
+                                       const double *dir_x, const double *dir_y, double *dist, int *side,
+                                       int *cell_x, int *cell_y)
+{
+    ray_packet_avx2(grid, player_x, player_y, dir_x, dir_y, dist, side, cell_x, cell_y, 0);
+}
+
+#endif
+
+// Picks the widest packet kernel this CPU runs, on doubles or, with
+// CUB3D_DDA_FIXED, on fixed point like the scalar loop. CUB3D_SIMD=0 forces
+// the scalar loop and CUB3D_SKIP=0 turns off block skipping, e.g. to compare
+// paths; hits are the same either way.
+t_packet_fn dda_select_packet(void)
+{
+    char *simd = getenv("CUB3D_SIMD");
+    char *skip_env = getenv("CUB3D_SKIP");
+    int skip = !(skip_env && *skip_env == '0');
+
+    if (simd && *simd == '0')
+        return skip ? cast_ray_packet_scalar : cast_ray_packet_scalar_plain;
+#ifdef DDA_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return skip ? cast_ray_packet_avx2 : cast_ray_packet_avx2_plain;
+#endif
+    return skip ? cast_ray_packet_scalar : cast_ray_packet_scalar_plain;
+}
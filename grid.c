@@ -0,0 +1,166 @@
+#include "cub3d.h"
+
+// Allocates a width*height grid inside a one-cell border, with every cell
+// including the border set to fill.
+int grid_alloc(t_grid *grid, int width, int height, char fill)
+{
+    size_t size;
+
+    grid->stride = width + 2;
+    size = (size_t)grid->stride * (height + 2);
+    grid->data = malloc(size);
+    if (!grid->data)
+        return -1;
+    memset(grid->data, fill, size);
+    grid->cells = grid->data + grid->stride + 1;
+    grid->solid = NULL;
+    grid->transposed = NULL;
+    memset(grid->occupied, 0, sizeof(grid->occupied));
+    grid->width = width;
+    grid->height = height;
+    return 0;
+}
+
+// Copies a NULL-terminated array of rows into the grid. Short rows are padded
+// with walls so every cell inside the rectangle is valid.
+int grid_from_rows(t_grid *grid, const char *const *rows)
+{
+    int width = 0;
+    int height = 0;
+
+    while (rows[height]) {
+        int len = strlen(rows[height]);
+        if (len > width)
+            width = len;
+        height++;
+    }
+    if (grid_alloc(grid, width, height, '1') != 0)
+        return -1;
+    for (int y = 0; y < height; y++)
+        memcpy(grid->cells + (size_t)y * grid->stride, rows[y], strlen(rows[y]));
+    return grid_build_solid(grid);
+}
+
+// Builds a bitmap with one bit per 8x8 bits of src, set when any of them is.
+// Returns the row count, or -1 when out of memory.
+static int coarsen(const uint64_t *src, int src_words, int src_rows, uint64_t **dst, int *dst_words)
+{
+    int rows = (src_rows + 7) / 8;
+
+    *dst_words = (src_words + 7) / 8;
+    *dst = calloc((size_t)*dst_words * rows, sizeof(uint64_t));
+    if (!*dst)
+        return -1;
+    for (int y = 0; y < src_rows; y++) {
+        const uint64_t *row = src + (size_t)y * src_words;
+        uint64_t *bits = *dst + (size_t)(y / 8) * *dst_words;
+
+        for (int w = 0; w < src_words; w++)
+            for (int k = 0; k < 8 && row[w]; k++)
+                if ((row[w] >> (k * 8)) & 0xFF)
+                    bits[w / 8] |= 1ULL << ((w % 8) * 8 + k);
+    }
+    return rows;
+}
+
+// Copies the solid bitmap column by column into the transposed one. Only
+// set bits are visited, so open maps transpose quickly.
+static int transpose(t_grid *grid)
+{
+    int rows = grid->height + 2;
+
+    grid->transposed_words = (rows + 63) / 64;
+    grid->transposed = calloc((size_t)grid->transposed_words * grid->stride, sizeof(uint64_t));
+    if (!grid->transposed)
+        return -1;
+    for (int y = 0; y < rows; y++) {
+        const uint64_t *bits = grid->solid + (size_t)y * grid->solid_words;
+
+        for (int w = 0; w < grid->solid_words; w++)
+            for (uint64_t word = bits[w]; word; word &= word - 1) {
+                size_t x = (size_t)w * 64 + __builtin_ctzll(word);
+
+                grid->transposed[x * grid->transposed_words + (y >> 6)] |= 1ULL << (y & 63);
+            }
+    }
+    return 0;
+}
+
+static void grid_free_bitmaps(t_grid *grid)
+{
+    free(grid->solid);
+    grid->solid = NULL;
+    free(grid->transposed);
+    grid->transposed = NULL;
+    for (int level = 0; level < GRID_LEVELS; level++) {
+        free(grid->occupied[level]);
+        grid->occupied[level] = NULL;
+    }
+}
+
+// Packs the wall test of every cell, border included, into the solid bitmap
+// and its transpose, and rebuilds the block pyramid over it. Call again
+// whenever walls change. Each build takes a new generation, never reused by
+// any grid, so caches of what rays hit can tell the walls are not the ones
+// they saw even when the grid struct is.
+int grid_build_solid(t_grid *grid)
+{
+    static uint32_t generation;
+    int rows = grid->height + 2;
+
+    grid->generation = ++generation;
+    grid_free_bitmaps(grid);
+    grid->solid_words = (grid->stride + 63) / 64;
+    grid->solid = calloc((size_t)grid->solid_words * rows, sizeof(uint64_t));
+    if (!grid->solid)
+        return -1;
+    for (int y = 0; y < rows; y++) {
+        const char *row = grid->data + (size_t)y * grid->stride;
+        uint64_t *bits = grid->solid + (size_t)y * grid->solid_words;
+        int x = 0;
+
+        // Eight cells at a time: one 0x01 per wall byte, then a multiply
+        // moves byte k's flag to bit 56 + k
+        for (; x + 8 <= grid->stride; x += 8) {
+            uint64_t walls = bytes_match(bytes_load(row + x), '1') >> 7;
+            bits[x >> 6] |= ((walls * 0x0102040810204080ULL) >> 56) << (x & 63);
+        }
+        for (; x < grid->stride; x++)
+            bits[x >> 6] |= (uint64_t)(row[x] == '1') << (x & 63);
+    }
+
+    if (transpose(grid) != 0)
+        return -1;
+
+    const uint64_t *src = grid->solid;
+    int src_words = grid->solid_words;
+
+    for (int level = 0; level < GRID_LEVELS; level++) {
+        rows = coarsen(src, src_words, rows, &grid->occupied[level], &grid->occupied_words[level]);
+        if (rows < 0)
+            return -1;
+        src = grid->occupied[level];
+        src_words = grid->occupied_words[level];
+    }
+    return 0;
+}
+
+void grid_destroy(t_grid *grid)
+{
+    grid_free_bitmaps(grid);
+    free(grid->data);
+    memset(grid, 0, sizeof(t_grid));
+}
+
+// Refills the border ring with walls, e.g. after loading used it as void.
+void grid_seal_border(t_grid *grid)
+{
+    size_t last_row = (size_t)(grid->height + 1) * grid->stride;
+
+    memset(grid->data, '1', grid->stride);
+    memset(grid->data + last_row, '1', grid->stride);
+    for (int y = 0; y < grid->height; y++) {
+        grid->cells[(size_t)y * grid->stride - 1] = '1';
+        grid->cells[(size_t)y * grid->stride + grid->width] = '1';
+    }
+}
@@ -0,0 +1,210 @@
+#include "cub3d.h"
+#include "include/lodepng/lodepng.h"
+#include <time.h>
+
+// Offscreen stand-in for the MLX window, for machines without a display or
+// GPU. Images are plain malloc'd framebuffers laid out like mlx_new_image's
+// (width, height, RGBA pixels), and the frame loop runs as fast as it can.
+
+#define PNG_STORED_BLOCK 65535
+
+mlx_image_t *headless_image(uint32_t width, uint32_t height)
+{
+    mlx_image_t init = {.width = width, .height = height, .enabled = true};
+    mlx_image_t *img = malloc(sizeof(mlx_image_t));
+
+    if (!img)
+        return NULL;
+    memcpy(img, &init, sizeof(mlx_image_t));
+    img->pixels = calloc((size_t)width * height, sizeof(uint32_t));
+    if (!img->pixels) {
+        free(img);
+        return NULL;
+    }
+    return img;
+}
+
+void headless_image_delete(mlx_image_t *img)
+{
+    if (!img)
+        return;
+    free(img->pixels);
+    free(img);
+}
+
+// Copies src onto dst with its top-left corner at (x, y), the way the window
+// stacks image instances: pixels with alpha 0 are transparent, any other
+// pixel replaces what is below it.
+static void blend(mlx_image_t *dst, const mlx_image_t *src, int x, int y)
+{
+    const uint8_t *pixels = src->pixels;
+
+    for (int sy = 0; sy < (int)src->height; sy++) {
+        if (y + sy < 0 || y + sy >= (int)dst->height)
+            continue;
+        for (int sx = 0; sx < (int)src->width; sx++) {
+            const uint8_t *p = pixels + ((size_t)sy * src->width + sx) * 4;
+
+            if (p[3] != 0 && x + sx >= 0 && x + sx < (int)dst->width)
+                memcpy(dst->pixels + ((size_t)(y + sy) * dst->width + x + sx) * 4, p, 4);
+        }
+    }
+}
+
+static uint8_t *put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+    return p + 4;
+}
+
+// Writes a chunk header at p and returns where its data goes
+static uint8_t *chunk_begin(uint8_t *p, size_t len, const char *type)
+{
+    put_be32(p, len);
+    memcpy(p + 4, type, 4);
+    return p + 8;
+}
+
+// Appends the CRC of the chunk that starts at start and whose data ends at end
+static uint8_t *chunk_end(uint8_t *start, uint8_t *end)
+{
+    return put_be32(end, lodepng_crc32(start + 4, end - start - 4));
+}
+
+static uint32_t adler32(uint32_t adler, const uint8_t *data, size_t len)
+{
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+
+    while (len > 0) {
+        // Largest run before b can overflow 32 bits
+        size_t run = len < 5552 ? len : 5552;
+
+        len -= run;
+        while (run--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return b << 16 | a;
+}
+
+// Writes img as an 8-bit RGBA PNG. The bundled lodepng is built without its
+// encoder, so the image data goes out as stored (uncompressed) deflate blocks;
+// lodepng still provides the CRCs and the file write.
+int headless_save_png(const mlx_image_t *img, const char *path)
+{
+    size_t row = (size_t)img->width * 4 + 1;
+    size_t raw_size = row * img->height;
+    size_t blocks = raw_size / PNG_STORED_BLOCK + 1;
+    size_t idat_size = 2 + raw_size + blocks * 5 + 4;
+    size_t size = 8 + 25 + 12 + idat_size + 12;
+    uint8_t *raw = malloc(raw_size);
+    uint8_t *png = malloc(size);
+    uint8_t *p = png;
+    uint8_t *chunk;
+    unsigned error = 1;
+
+    if (!raw || !png)
+        goto done;
+    // Filter type 0 in front of every row, then the pixels as they are
+    for (uint32_t y = 0; y < img->height; y++) {
+        raw[y * row] = 0;
+        memcpy(raw + y * row + 1, img->pixels + (size_t)y * img->width * 4, row - 1);
+    }
+
+    memcpy(p, "\x89PNG\r\n\x1a\n", 8);
+    chunk = p + 8;
+    p = chunk_begin(chunk, 13, "IHDR");
+    p = put_be32(p, img->width);
+    p = put_be32(p, img->height);
+    memcpy(p, "\x08\x06\x00\x00\x00", 5);
+    p = chunk_end(chunk, p + 5);
+
+    chunk = p;
+    p = chunk_begin(chunk, idat_size, "IDAT");
+    *p++ = 0x78;
+    *p++ = 0x01;
+    for (size_t copied = 0, i = 0; i < blocks; i++) {
+        size_t len = raw_size - copied < PNG_STORED_BLOCK ? raw_size - copied : PNG_STORED_BLOCK;
+
+        *p++ = i + 1 == blocks;
+        *p++ = len;
+        *p++ = len >> 8;
+        *p++ = ~len;
+        *p++ = ~len >> 8;
+        memcpy(p, raw + copied, len);
+        p += len;
+        copied += len;
+    }
+    p = put_be32(p, adler32(1, raw, raw_size));
+    p = chunk_end(chunk, p);
+
+    chunk = p;
+    p = chunk_end(chunk, chunk_begin(chunk, 0, "IEND"));
+    error = lodepng_save_file(png, p - png, path);
+done:
+    free(raw);
+    free(png);
+    if (error)
+        fprintf(stderr, "Error\ncannot write %s\n", path);
+    return error ? -1 : 0;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Runs frames frames of a scripted walk: always forward, always turning,
+// sliding along walls exactly like the keyboard loop, one simulation step
+// per frame. Prints the frame times; with dump_dir set, also writes every
+// frame as dump_dir/frame_NNNNN.png.
+int headless_run(t_player *player, int frames, const char *dump_dir)
+{
+    t_input input = {.forward = 1, .turn = 1};
+    mlx_image_t *frame = NULL;
+    double total = 0;
+    double slowest = 0;
+
+    if (dump_dir && !(frame = headless_image(player->view->width, player->view->height)))
+        return -1;
+    for (int i = 0; i < frames; i++) {
+        double start = now();
+
+        player_update(player, &input);
+        t_pose pose = player_pose(player);
+        render_frame(player, &pose);
+
+        double elapsed = now() - start;
+        total += elapsed;
+        slowest = elapsed > slowest ? elapsed : slowest;
+        if (frame) {
+            char path[4096];
+
+            memcpy(frame->pixels, player->view->pixels, (size_t)frame->width * frame->height * 4);
+            if (player->map->enabled) {
+                blend(frame, player->map, 0, 0);
+                blend(frame, player->direction_ray, 0, 0);
+                blend(frame, player->img, (int)player->x_pos, (int)player->y_pos);
+            }
+            snprintf(path, sizeof(path), "%s/frame_%05d.png", dump_dir, i);
+            if (headless_save_png(frame, path) != 0) {
+                headless_image_delete(frame);
+                return -1;
+            }
+        }
+    }
+    headless_image_delete(frame);
+    printf("headless: %d frames, %.3f ms/frame average, %.3f ms slowest\n", frames,
+           frames ? total / frames * 1e3 : 0.0, slowest * 1e3);
+    return 0;
+}
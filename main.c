@@ -1,43 +1,10 @@
-#include "include/MLX42/MLX42.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
+#include "cub3d.h"
+#include <unistd.h>
 
-#define TILE_SIZE 32
-#define FOV 60
-#define PI 3.14159265358979323846
-
-typedef struct s_player
-{
-    char ** map;
-    int size;
-    float direction_angle;
-    double x_pos;
-    double y_pos;
-    double reminder_x;
-    double reminder_y;
-    mlx_t *mlx;
-    mlx_image_t *img;
-    mlx_image_t *direction_ray;
-} t_player;
-
-float deg_to_radian(float deg)
-{
-    return (deg * PI / 180);
-}
-
-float normalize_angle(float angle)
-{
-    angle = fmod(angle ,2 * PI);
-    if (angle < 0)
-        angle = (2 * PI) + angle;
-    return angle;
-}
-
-char **create_dynamic_map(void)
+// Built-in scene used when no .cub file is given
+int create_dynamic_map(t_scene *scene)
 {
-    char *static_map[] = {
+    static const char *const static_map[] = {
         "111111111111111111111",
         "100000000010000000001",
         "101111010010101111101",
@@ -50,69 +17,31 @@ char **create_dynamic_map(void)
         NULL
     };
 
-    int rows = 0;
-    while (static_map[rows] != NULL)
-        rows++;
-
-    char **dynamic_map = malloc((rows + 1) * sizeof(char *));
-    if (!dynamic_map)
-        return NULL;
-
-    for (int i = 0; i < rows; i++) {
-        dynamic_map[i] = strdup(static_map[i]);
-        if (!dynamic_map[i]) {
-            for (int j = 0; j < i; j++)
-                free(dynamic_map[j]);
-            free(dynamic_map);
-            return NULL;
-        }
-    }
-    dynamic_map[rows] = NULL;
-    return dynamic_map;
-}
-
-void draw_line(mlx_image_t *img, int x0, int y0, int x1, int y1, int color)
-{
-    int dx = abs(x1 - x0);
-    int dy = abs(y1 - y0);
-    int sx = (x0 < x1) ? 1 : -1;
-    int sy = (y0 < y1) ? 1 : -1;
-    int err = dx - dy;
-    int e2;
-
-    while (1)
-    {
-        x0 < img->width && y0 < img->height ? mlx_put_pixel(img, x0, y0, color) : NULL;
-        if (x0 == x1 && y0 == y1)
-            break;
-        e2 = 2 * err;
-        if (e2 > -dy)
-        {
-            err -= dy;
-            x0 += sx;
-        }
-        if (e2 < dx)
-        {
-            err += dx;
-            y0 += sy;
-        }
-    }
+    memset(scene, 0, sizeof(t_scene));
+    scene->floor_color = 0xFFFFFFFF;
+    scene->ceiling_color = 0x000000FF;
+    scene->spawn_x = 5;
+    scene->spawn_y = 3;
+    scene->spawn_angle = deg_to_radian(90);
+    return grid_from_rows(&scene->grid, static_map);
 }
 
 void draw_square(mlx_image_t *img, int x, int y, int color)
 {
-    for (int i = 0; i < TILE_SIZE - 1; i++) {
-        for (int j = 0; j < TILE_SIZE - 1; j++) {
-            mlx_put_pixel(img, x + j, y + i, color);
-        }
-    }
+    raster_rect(img, x, y, TILE_SIZE - 1, TILE_SIZE - 1, color);
 }
 
-void build_map(char **map, mlx_image_t *img) {
-    for (int i = 0; map[i]; i++) {
-        for (int j = 0; map[i][j]; j++) {
-            draw_square(img, j * TILE_SIZE, i * TILE_SIZE, 
-                       map[i][j] == '1' ? 0x000000FF : 0xFFFFFFFF);
+void build_map(const t_grid *map, mlx_image_t *img) {
+    // Only whole tiles that fit in the image; large maps are cut at the edge
+    int rows = map->height < (int)img->height / TILE_SIZE ? map->height : (int)img->height / TILE_SIZE;
+    int cols = map->width < (int)img->width / TILE_SIZE ? map->width : (int)img->width / TILE_SIZE;
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            char cell = map->cells[i * map->stride + j];
+            if (cell != ' ')
+                draw_square(img, j * TILE_SIZE, i * TILE_SIZE, 
+                           cell == '1' ? 0x000000FF : 0xFFFFFFFF);
         }
     }
 }
@@ -122,259 +51,166 @@ int32_t ft_pixel(int32_t r, int32_t g, int32_t b, int32_t a)
     return (r << 24 | g << 16 | b << 8 | a);
 }
 
-double cast_single_ray_distance(char **map, double player_x, double player_y, double ray_dir_x, double ray_dir_y)
+// Movement intent from the keys held right now
+static void read_input(mlx_t *mlx, t_input *input)
 {
-    // Convert to map coordinates
-    double pos_x = player_x / TILE_SIZE;
-    double pos_y = player_y / TILE_SIZE;
-    
-    // Current map position
-    int map_x = (int)pos_x;
-    int map_y = (int)pos_y;
-    
-    // Distance ray travels for each unit step
-    double delta_dist_x = fabs(1.0 / ray_dir_x);
-    double delta_dist_y = fabs(1.0 / ray_dir_y);
-    
-    // Step direction and initial distances
-    int step_x, step_y;
-    double side_dist_x, side_dist_y;
-    
-    if (ray_dir_x < 0) {
-        step_x = -1;
-        side_dist_x = (pos_x - map_x) * delta_dist_x;
-    } else {
-        step_x = 1;
-        side_dist_x = (map_x + 1.0 - pos_x) * delta_dist_x;
-    }
-    
-    if (ray_dir_y < 0) {
-        step_y = -1;
-        side_dist_y = (pos_y - map_y) * delta_dist_y;
-    } else {
-        step_y = 1;
-        side_dist_y = (map_y + 1.0 - pos_y) * delta_dist_y;
-    }
-    
-    // DDA loop
-    int hit = 0;
-    int side;
-    
-    while (hit == 0) {
-        if (side_dist_x < side_dist_y) {
-            side_dist_x += delta_dist_x;
-            map_x += step_x;
-            side = 0;
-        } else {
-            side_dist_y += delta_dist_y;
-            map_y += step_y;
-            side = 1;
-        }
-        
-        // Check bounds and wall hit
-        if (map[map_y] && map[map_y][map_x] && map[map_y][map_x] == '1') {
-            hit = 1;
-        }
-    }
-    
-    double wall_dist;
-    if (side == 0) {
-        wall_dist = (map_x - pos_x + (1 - step_x) / 2) / ray_dir_x;
-    } else {
-        wall_dist = (map_y - pos_y + (1 - step_y) / 2) / ray_dir_y;
-    }
-    
-    return wall_dist * TILE_SIZE;
-}
-
-void cast_fov_rays(t_player *player, char **map)
-{
-    memset(player->direction_ray->pixels, 0, 
-          player->direction_ray->width * player->direction_ray->height * sizeof(int32_t));
-    
-    double player_x = player->img->instances->x + player->size / 2.0;
-    double player_y = player->img->instances->y + player->size / 2.0;
-    
-    int num_rays = player->mlx->width;
-    double fov_radians = deg_to_radian(80);  // 60 degrees in radians
-    double angle_step = fov_radians / num_rays;
-    
-    // Starting angle (left edge of FOV)
-    double start_angle = player->direction_angle - (fov_radians /2);
-    
-    // Cast each ray
-    for (int i = 0; i < num_rays; i++) {
-        // Current ray angle
-        double ray_angle = start_angle + (i * angle_step);
-        ray_angle = normalize_angle(ray_angle);
-        
-        // Ray direction
-        double ray_dir_x = cos(ray_angle);
-        double ray_dir_y = sin(ray_angle);
-        
-        // Cast the ray and get distance
-        double wall_dist = cast_single_ray_distance(map, player_x, player_y, ray_dir_x, ray_dir_y);
-        
-        // Calculate end point
-        int end_x = (int)(player_x + ray_dir_x * wall_dist);
-        int end_y = (int)(player_y + ray_dir_y * wall_dist);
-        
-        // Choose color based on ray (center ray red, others yellow)
-        int color = 0xFF0000FF;
-        
-        // Draw the ray
-        draw_line(player->direction_ray, 
-                 (int)player_x, (int)player_y, 
-                 end_x, end_y, color);
-    }
-}
+    *input = (t_input){0, 0, 0};
+    if (mlx_is_key_down(mlx, MLX_KEY_W) || mlx_is_key_down(mlx, MLX_KEY_UP))
+        input->forward = 1;
+    if (mlx_is_key_down(mlx, MLX_KEY_S) || mlx_is_key_down(mlx, MLX_KEY_DOWN))
+        input->forward = -1;
 
-int is_wall(t_player *player, int x, int y)
-{
-    // Convert pixel coordinates to map coordinates
-    int map_x = x / TILE_SIZE;
-    int map_y = y / TILE_SIZE;
-    
-    // Check bounds - make sure we don't go out of map
-    if (map_x < 0 || map_y < 0)
-        return (1); // Treat out of bounds as walls
-    
-    // Check if row exists
-    if (!player->map[map_y])
-        return (1);
-    
-    // Check if column exists in this row
-    if (map_x >= (int)strlen(player->map[map_y]))
-        return (1);
-    
-    // Check if position is a wall
-    return (player->map[map_y][map_x] == '1');
-}
+    if (mlx_is_key_down(mlx, MLX_KEY_A))
+        input->sideways = -1;
+    if (mlx_is_key_down(mlx, MLX_KEY_D))
+        input->sideways = 1;
 
-// Check collision for the player's square hitbox
-int check_collision_square(t_player *player, int new_x, int new_y)
-{
-    // Check all four corners of the player square
-    if (is_wall(player, new_x, new_y) ||                           // Top-left
-        is_wall(player, new_x + player->size - 1, new_y) ||        // Top-right
-        is_wall(player, new_x, new_y + player->size - 1) ||        // Bottom-left
-        is_wall(player, new_x + player->size - 1, new_y + player->size - 1)) // Bottom-right
-        return (1); // Collision detected
-    
-    return (0); // No collision
+    if (mlx_is_key_down(mlx, MLX_KEY_LEFT))
+        input->turn -= 1;
+    if (mlx_is_key_down(mlx, MLX_KEY_RIGHT))
+        input->turn += 1;
 }
 
-
-void move_player(void *param)
+// Window loop hook. The simulation advances in fixed steps of 1 / SIM_RATE
+// seconds on mlx_get_time, however fast the loop spins, so movement speed
+// and results do not depend on the frame rate. The view is drawn from the
+// pose between the last two steps, as far along as the time not yet
+// simulated; a frame whose pose is the one on screen is not drawn at all,
+// and the loop sleeps until the next step is due.
+void game_loop(void *param)
 {
     t_player *player = (t_player *)param;
     mlx_t *mlx = player->mlx;
-
-    int move_forward = 0;
-    int move_sideways = 0;
-
-    double rot_speed = 0.04;
-    double move_speed = 2;
+    double step = 1.0 / SIM_RATE;
+    double now = mlx_get_time();
+    int steps = 0;
+    t_input input;
 
     if (mlx_is_key_down(mlx, MLX_KEY_ESCAPE))
         mlx_close_window(mlx);
 
-    if (mlx_is_key_down(mlx, MLX_KEY_W) || mlx_is_key_down(mlx, MLX_KEY_UP))
-        move_forward = move_speed;
-    if (mlx_is_key_down(mlx, MLX_KEY_S) || mlx_is_key_down(mlx, MLX_KEY_DOWN))
-        move_forward = -move_speed;
+    player->lag += now - player->clock;
+    player->clock = now;
+    while (player->lag >= step && steps++ < SIM_MAX_STEPS) {
+        read_input(mlx, &input);
+        player->previous = player_pose(player);
+        player_update(player, &input);
+        player->lag -= step;
+    }
+    if (player->lag >= step)
+        player->lag = fmod(player->lag, step);
 
-    if (mlx_is_key_down(mlx, MLX_KEY_A))
-        move_sideways = -move_speed;
-    if (mlx_is_key_down(mlx, MLX_KEY_D))
-        move_sideways = move_speed;
+    t_pose current = player_pose(player);
+    t_pose pose = pose_lerp(&player->previous, &current, player->lag / step);
 
-    if (mlx_is_key_down(mlx, MLX_KEY_LEFT))
-        player->direction_angle -= rot_speed;
-    if (mlx_is_key_down(mlx, MLX_KEY_RIGHT))
-        player->direction_angle += rot_speed;
-    
-    player->direction_angle = normalize_angle(player->direction_angle);
+    if (!player->redraw && !memcmp(&pose, &player->drawn, sizeof(t_pose))) {
+        usleep((step - player->lag) * 1e6);
+        return;
+    }
+    player->img->instances->x = pose.x;
+    player->img->instances->y = pose.y;
+    render_frame(player, &pose);
+    player->drawn = pose;
+    player->redraw = false;
+}
 
-    double forward_x = cos(player->direction_angle) * move_forward;
-    double forward_y = sin(player->direction_angle) * move_forward;
-    
-    float strafe_angle = player->direction_angle + PI/2;
-    double strafe_x = cos(strafe_angle) * move_sideways;
-    double strafe_y = sin(strafe_angle) * move_sideways;
-    
-    float total_x = forward_x + strafe_x + player->reminder_x;
-    float total_y = forward_y + strafe_y + player->reminder_y;
+// Shows or hides the minimap layers over the first-person view
+void set_minimap(t_player *player, bool shown)
+{
+    player->map->enabled = shown;
+    player->img->enabled = shown;
+    player->direction_ray->enabled = shown;
+    player->redraw = true;
+}
 
-    int move_x = (int)round(total_x);
-    int move_y = (int)round(total_y);
-    
-      // Get current position
-    int current_x = player->img->instances->x;
-    int current_y = player->img->instances->y;
-    
-    // Calculate new positions
-    int new_x = current_x + move_x;
-    int new_y = current_y + move_y;
-    
-    // Separate X and Y collision checking for sliding along walls
-    int can_move_x = !check_collision_square(player, new_x, current_y);
-    int can_move_y = !check_collision_square(player, current_x, new_y);
-    
-    // Apply movement based on collision results
-    if (can_move_x)
-    {
-        player->img->instances->x = new_x;
-        player->reminder_x = total_x - move_x;
-    }
-    else
-        player->reminder_x = 0; // Reset reminder if we can't move
-    
-    if (can_move_y)
-    {
-        player->img->instances->y = new_y;
-        player->reminder_y = total_y - move_y;
-    }
-    else
-        player->reminder_y = 0; // Reset reminder if we can't move
+void toggle_minimap(mlx_key_data_t key, void *param)
+{
+    t_player *player = (t_player *)param;
+
+    if (key.key == MLX_KEY_M && key.action == MLX_PRESS)
+        set_minimap(player, !player->map->enabled);
+}
 
-    cast_fov_rays(player, player->map);
+// Window images come from MLX; headless ones are plain framebuffers
+static mlx_image_t *new_image(t_player *player, uint32_t width, uint32_t height)
+{
+    if (!player->mlx)
+        return headless_image(width, height);
+    return mlx_new_image(player->mlx, width, height);
+}
+
+static void show_image(t_player *player, mlx_image_t *img, int x, int y)
+{
+    if (player->mlx)
+        mlx_image_to_window(player->mlx, img, x, y);
 }
 
-int main()
+int main(int argc, char **argv)
 {
-    char **map = create_dynamic_map();
     t_player player;
+    if (argc > 2) {
+        fprintf(stderr, "Error\nusage: %s [map.cub]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2 ? scene_load(&player.scene, argv[1]) != 0 : create_dynamic_map(&player.scene) != 0)
+        return 1;
+    if (scene_load_textures(&player.scene) != 0) {
+        scene_destroy(&player.scene);
+        return 1;
+    }
     player.size = 6;
     player.reminder_x = 0;
     player.reminder_y = 0;
-    player.direction_angle = deg_to_radian(90);
-    player.map = map;
-    int SCREEN_WIDTH = strlen(*map) * TILE_SIZE;
-    int SCREEN_HEIGHT = 9 * TILE_SIZE;
-
-    mlx_t* mlx = mlx_init(SCREEN_WIDTH, SCREEN_HEIGHT, "cub", false);
-    if (!mlx)
+    player.direction_angle = player.scene.spawn_angle;
+    int SCREEN_WIDTH = player.scene.grid.width * TILE_SIZE;
+    int SCREEN_HEIGHT = player.scene.grid.height * TILE_SIZE;
+    if (SCREEN_WIDTH > MAX_SCREEN_WIDTH)
+        SCREEN_WIDTH = MAX_SCREEN_WIDTH;
+    if (SCREEN_HEIGHT > MAX_SCREEN_HEIGHT)
+        SCREEN_HEIGHT = MAX_SCREEN_HEIGHT;
+
+    if (caster_init(&player.caster, pool_default_threads()) != 0
+        || caster_reserve(&player.caster, SCREEN_WIDTH, SCREEN_HEIGHT) != 0) {
+        fprintf(stderr, "Error\nout of memory\n");
+        caster_destroy(&player.caster);
+        scene_destroy(&player.scene);
         return 1;
-    player.mlx = mlx;
-
-    mlx_image_t* img = mlx_new_image(mlx, SCREEN_WIDTH, SCREEN_HEIGHT);
-    build_map(map, img);
-    mlx_image_to_window(mlx, img, 0, 0);
-
-    int start_x = 5 * TILE_SIZE - player.size/2;
-    int start_y = 3 * TILE_SIZE - player.size/2;
+    }
 
-    player.img = mlx_new_image(mlx, player.size, player.size);
-    for (int y = 0; y < player.size; y++) {
-        for (int x = 0; x < player.size; x++) {
-            mlx_put_pixel(player.img, x, y, 0xFF0000FF);
+    // CUB3D_HEADLESS=<frames> runs that many scripted frames without a
+    // window, CUB3D_DUMP=<dir> also saves each of them as a PNG
+    char *headless = getenv("CUB3D_HEADLESS");
+    player.mlx = NULL;
+    if (!headless) {
+        player.mlx = mlx_init(SCREEN_WIDTH, SCREEN_HEIGHT, "cub", false);
+        if (!player.mlx) {
+            caster_destroy(&player.caster);
+            scene_destroy(&player.scene);
+            return 1;
         }
     }
-    mlx_image_to_window(mlx, player.img, start_x + TILE_SIZE / 2, start_y + TILE_SIZE /2);
 
-    player.direction_ray = mlx_new_image(mlx, SCREEN_WIDTH, SCREEN_HEIGHT);
-    mlx_image_to_window(mlx, player.direction_ray, 0, 0);
+    player.view = new_image(&player, SCREEN_WIDTH, SCREEN_HEIGHT);
+    show_image(&player, player.view, 0, 0);
+
+    player.map = new_image(&player, SCREEN_WIDTH, SCREEN_HEIGHT);
+    build_map(&player.scene.grid, player.map);
+    show_image(&player, player.map, 0, 0);
+
+    int start_x = player.scene.spawn_x * TILE_SIZE - player.size/2;
+    int start_y = player.scene.spawn_y * TILE_SIZE - player.size/2;
+    player.x_pos = start_x + TILE_SIZE / 2;
+    player.y_pos = start_y + TILE_SIZE / 2;
+
+    player.img = new_image(&player, player.size, player.size);
+    raster_rect(player.img, 0, 0, player.size, player.size, 0xFF0000FF);
+    show_image(&player, player.img, player.x_pos, player.y_pos);
+
+    player.direction_ray = new_image(&player, SCREEN_WIDTH, SCREEN_HEIGHT);
+    player.ray_dirty = rect_empty();
+    show_image(&player, player.direction_ray, 0, 0);
+    set_minimap(&player, false);
+    player.previous = player_pose(&player);
 
     int player_center_x = start_x + player.size/2;
     int player_center_y = start_y + player.size/2;
@@ -382,13 +218,28 @@ int main()
     int end_x = player_center_x + cos(player.direction_angle) * 60;
     int end_y = player_center_y + sin(player.direction_angle) * 60;
 
-    mlx_loop_hook(mlx, move_player, &player);
+    if (headless) {
+        int status = headless_run(&player, atoi(headless), getenv("CUB3D_DUMP"));
+
+        headless_image_delete(player.view);
+        headless_image_delete(player.map);
+        headless_image_delete(player.img);
+        headless_image_delete(player.direction_ray);
+        caster_destroy(&player.caster);
+        scene_destroy(&player.scene);
+        return status != 0;
+    }
+
+    mlx_t *mlx = player.mlx;
+    player.clock = mlx_get_time();
+    player.lag = 0;
+    mlx_loop_hook(mlx, game_loop, &player);
+    mlx_key_hook(mlx, toggle_minimap, &player);
     mlx_loop(mlx);
     
     mlx_terminate(mlx);
-    for (int i = 0; map[i]; i++)
-        free(map[i]);
-    free(map);
+    caster_destroy(&player.caster);
+    scene_destroy(&player.scene);
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include "cub3d.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Flat shades for faces without a texture, lighter on x grid lines
+#define WALL_COLOR_X 0xB4B4B4FF
+#define WALL_COLOR_Y 0x8C8C8CFF
+// Sprites drawn without a texture are flat squares of this color
+#define SPRITE_COLOR 0xE0B030FF
+// Header elements every scene must have: all but S
+#define HEADER_REQUIRED 0x3F
+
+// A byte range of the mapped file; lines never include their '\n' (or '\r').
+typedef struct s_span
+{
+    const char *p;
+    const char *end;
+} t_span;
+
+static int load_error(const char *msg)
+{
+    fprintf(stderr, "Error\n%s\n", msg);
+    return -1;
+}
+
+static t_span next_line(t_span *file)
+{
+    t_span line;
+    const char *nl = memchr(file->p, '\n', file->end - file->p);
+
+    line.p = file->p;
+    line.end = nl ? nl : file->end;
+    file->p = nl ? nl + 1 : file->end;
+    if (line.end > line.p && line.end[-1] == '\r')
+        line.end--;
+    return line;
+}
+
+static const char *skip_spaces(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+static int is_blank(t_span line)
+{
+    return skip_spaces(line.p, line.end) == line.end;
+}
+
+static int parse_color(t_span value, uint32_t *color)
+{
+    int rgb[3];
+    const char *p = value.p;
+
+    for (int i = 0; i < 3; i++) {
+        p = skip_spaces(p, value.end);
+        if (p == value.end || *p < '0' || *p > '9')
+            return -1;
+        rgb[i] = 0;
+        while (p < value.end && *p >= '0' && *p <= '9' && rgb[i] <= 255)
+            rgb[i] = rgb[i] * 10 + (*p++ - '0');
+        if (rgb[i] > 255)
+            return -1;
+        p = skip_spaces(p, value.end);
+        if (i < 2 && (p == value.end || *p++ != ','))
+            return -1;
+    }
+    if (p != value.end)
+        return -1;
+    *color = (uint32_t)(rgb[0] << 24 | rgb[1] << 16 | rgb[2] << 8 | 0xFF);
+    return 0;
+}
+
+// Handles one "ID value" header line. Returns 1 if the line is not a header
+// element (the map starts there), 0 on success and -1 on error. Element ids
+// are indices into the texture enum; S, the sprite texture, is optional.
+static int parse_header_line(t_scene *scene, t_span line, int *seen)
+{
+    static const char *const ids[TEX_COUNT] = {"NO", "SO", "WE", "EA", "F", "C", "S"};
+    const char *p = skip_spaces(line.p, line.end);
+    int id = -1;
+
+    for (int i = 0; i < TEX_COUNT && id < 0; i++) {
+        size_t len = strlen(ids[i]);
+        if ((size_t)(line.end - p) > len && !memcmp(p, ids[i], len) && (p[len] == ' ' || p[len] == '\t'))
+            id = i;
+    }
+    if (id < 0)
+        return (*p == '1' || *p == '0') ? 1 : load_error("unknown element in scene header");
+    if (*seen & (1 << id))
+        return load_error("duplicate element in scene header");
+    *seen |= 1 << id;
+
+    t_span value = {skip_spaces(p + strlen(ids[id]), line.end), line.end};
+    while (value.end > value.p && (value.end[-1] == ' ' || value.end[-1] == '\t'))
+        value.end--;
+    // Floor and ceiling take a color, or a texture path like the walls
+    if ((id == TEX_FLOOR || id == TEX_CEILING) && value.p < value.end && *value.p >= '0' && *value.p <= '9') {
+        if (parse_color(value, id == TEX_FLOOR ? &scene->floor_color : &scene->ceiling_color) != 0)
+            return load_error("invalid color, expected R,G,B in 0-255");
+        return 0;
+    }
+    if (value.p == value.end)
+        return load_error("missing texture path");
+    scene->textures[id] = strndup(value.p, value.end - value.p);
+    return scene->textures[id] ? 0 : load_error("out of memory");
+}
+
+// Checks one cell: only "012 NSEW" are allowed, and no walkable cell may have
+// a void neighbour. The grid border is still void while loading, so walkable
+// cells on the map edge fail too. Also picks up the spawn marker and the
+// sprites, which stand in the middle of an open cell.
+static int check_cell(t_scene *scene, char *cell)
+{
+    int stride = scene->grid.stride;
+    char c = *cell;
+
+    if (c == '1' || c == ' ')
+        return 0;
+    if (cell[-1] == ' ' || cell[1] == ' ' || cell[-stride] == ' ' || cell[stride] == ' ')
+        return load_error("map is not closed by walls");
+    if (c == '0')
+        return 0;
+    if (c == '2') {
+        int x = (cell - scene->grid.cells) % stride;
+        int y = (cell - scene->grid.cells) / stride;
+
+        *cell = '0';
+        if (sprites_add(&scene->sprites, (x + 0.5f) * TILE_SIZE, (y + 0.5f) * TILE_SIZE) != 0)
+            return load_error("out of memory");
+        return 0;
+    }
+    if (c != 'N' && c != 'S' && c != 'E' && c != 'W')
+        return load_error("invalid character in map");
+    if (scene->spawn_x >= 0)
+        return load_error("map has more than one player start");
+    scene->spawn_x = (cell - scene->grid.cells) % stride;
+    scene->spawn_y = (cell - scene->grid.cells) / stride;
+    scene->spawn_angle = c == 'N' ? 3 * PI / 2 : c == 'S' ? PI / 2 : c == 'W' ? PI : 0;
+    *cell = '0';
+    return 0;
+}
+
+// Runs check_cell over row y, eight cells at a time: plain '0' cells only
+// need their neighbours tested, which is done for the whole word at once, and
+// anything else falls back to check_cell.
+static int check_row(t_scene *scene, int y)
+{
+    t_grid *grid = &scene->grid;
+    char *row = grid->cells + (size_t)y * grid->stride;
+    int x = 0;
+
+    for (; x + 8 <= grid->width; x += 8) {
+        uint64_t cur = bytes_load(row + x);
+        uint64_t walk = ~(bytes_match(cur, '1') | bytes_match(cur, ' ')) & 0x8080808080808080ULL;
+        uint64_t open = bytes_match(bytes_load(row + x - 1), ' ') | bytes_match(bytes_load(row + x + 1), ' ')
+            | bytes_match(bytes_load(row + x - grid->stride), ' ')
+            | bytes_match(bytes_load(row + x + grid->stride), ' ');
+
+        if ((walk & open) || (walk & ~bytes_match(cur, '0')))
+            for (int i = 0; i < 8; i++)
+                if (check_cell(scene, row + x + i) != 0)
+                    return -1;
+    }
+    for (; x < grid->width; x++)
+        if (check_cell(scene, row + x) != 0)
+            return -1;
+    return 0;
+}
+
+// Copies the map lines into the grid, validating each row one line behind
+// the copy so its lower neighbour is already in place.
+static int parse_grid(t_scene *scene, t_span map)
+{
+    t_span file = map;
+    int width = 0;
+    int height = 0;
+    int rows = 0;
+
+    // Size the grid: longest line, and the line count without trailing blanks
+    while (file.p < file.end) {
+        t_span line = next_line(&file);
+        rows++;
+        if (!is_blank(line))
+            height = rows;
+        if (line.end - line.p > width)
+            width = line.end - line.p;
+    }
+    if (height == 0)
+        return load_error("missing map");
+    if (grid_alloc(&scene->grid, width, height, ' ') != 0)
+        return load_error("out of memory");
+
+    t_grid *grid = &scene->grid;
+    file = map;
+    for (int y = 0; y < height; y++) {
+        t_span line = next_line(&file);
+        char *row = grid->cells + (size_t)y * grid->stride;
+        size_t len = line.end - line.p;
+
+        if (len == 0)
+            return load_error("empty line inside the map");
+        memcpy(row, line.p, len);
+        if (y > 0 && check_row(scene, y - 1) != 0)
+            return -1;
+    }
+    if (check_row(scene, height - 1) != 0)
+        return -1;
+    if (scene->spawn_x < 0)
+        return load_error("map has no player start");
+    grid_seal_border(grid);
+    if (grid_build_solid(grid) != 0)
+        return load_error("out of memory");
+    return 0;
+}
+
+static int has_cub_extension(const char *path)
+{
+    size_t len = strlen(path);
+    return len > 4 && strcmp(path + len - 4, ".cub") == 0;
+}
+
+// Loads a .cub scene: the six header elements in any order, then the map.
+// The file is mapped read-only and parsed in place; only the texture paths
+// and the grid itself are allocated. On error prints "Error\n<reason>" and
+// returns -1, leaving nothing allocated.
+int scene_load(t_scene *scene, const char *path)
+{
+    struct stat st;
+    int fd;
+    int seen = 0;
+    int status = 0;
+
+    memset(scene, 0, sizeof(t_scene));
+    scene->spawn_x = -1;
+    if (!has_cub_extension(path))
+        return load_error("scene file must end in .cub");
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        if (fd >= 0)
+            close(fd);
+        return load_error("cannot read scene file");
+    }
+#ifdef MAP_POPULATE
+    char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+#else
+    char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+#endif
+    close(fd);
+    if (data == MAP_FAILED)
+        return load_error("cannot map scene file");
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    t_span file = {data, data + st.st_size};
+    t_span line;
+    while (file.p < file.end && status == 0) {
+        line = next_line(&file);
+        if (!is_blank(line))
+            status = parse_header_line(scene, line, &seen);
+    }
+    if (status == 0)
+        status = load_error("missing map");
+    else if (status == 1 && (seen & HEADER_REQUIRED) != HEADER_REQUIRED)
+        status = load_error("missing element in scene header");
+    else if (status == 1)
+        status = parse_grid(scene, (t_span){line.p, file.end});
+    munmap(data, st.st_size);
+    if (status != 0)
+        scene_destroy(scene);
+    return status;
+}
+
+// MLX loads PNGs as RGBA bytes, the layout texture_from_rgba takes
+static int texture_load(t_texture *tex, const char *path)
+{
+    mlx_texture_t *png = mlx_load_png(path);
+    int status = -1;
+
+    if (!png)
+        return -1;
+    if (png->bytes_per_pixel == 4)
+        status = texture_from_rgba(tex, png->pixels, png->width, png->height);
+    mlx_delete_texture(png);
+    return status;
+}
+
+// Loads the textures named in the scene. Wall faces without a path (the
+// built-in map) get a flat shade instead and sprites a flat square; a floor
+// or ceiling without one keeps its color. On error prints "Error\n<reason>"
+// and returns -1; scene_destroy frees what was loaded.
+int scene_load_textures(t_scene *scene)
+{
+    for (int i = 0; i < TEX_COUNT; i++) {
+        uint32_t shade = i == TEX_WE || i == TEX_EA ? WALL_COLOR_X : WALL_COLOR_Y;
+
+        shade = i == TEX_SPRITE ? SPRITE_COLOR : shade;
+        if (!scene->textures[i]) {
+            if ((i < TEX_FLOOR || i == TEX_SPRITE) && texture_flat(&scene->surfaces[i], shade) != 0)
+                return load_error("out of memory");
+        }
+        else if (texture_load(&scene->surfaces[i], scene->textures[i]) != 0) {
+            fprintf(stderr, "Error\ncannot load texture %s\n", scene->textures[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void scene_destroy(t_scene *scene)
+{
+    for (int i = 0; i < TEX_COUNT; i++) {
+        free(scene->textures[i]);
+        texture_destroy(&scene->surfaces[i]);
+    }
+    grid_destroy(&scene->grid);
+    sprites_destroy(&scene->sprites);
+    memset(scene, 0, sizeof(t_scene));
+}
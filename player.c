@@ -0,0 +1,88 @@
+#include "cub3d.h"
+
+// Whether the player square with its top-left corner at (x, y) would touch
+// a wall
+static int square_collides(const t_player *player, int x, int y)
+{
+    t_box box = {x, y, player->size, player->size};
+
+    return collide_box(&player->scene.grid, &box);
+}
+
+// Applies one simulation step of input: turn, then move with separate X and
+// Y collision checks so the player slides along walls.
+void player_update(t_player *player, const t_input *input)
+{
+    double rot_speed = 0.04;
+    double move_speed = 2;
+
+    int move_forward = input->forward * move_speed;
+    int move_sideways = input->sideways * move_speed;
+
+    player->direction_angle += input->turn * rot_speed;
+    player->direction_angle = normalize_angle(player->direction_angle);
+
+    double forward_x = angle_cos(player->direction_angle) * move_forward;
+    double forward_y = angle_sin(player->direction_angle) * move_forward;
+    
+    float strafe_angle = player->direction_angle + PI/2;
+    double strafe_x = angle_cos(strafe_angle) * move_sideways;
+    double strafe_y = angle_sin(strafe_angle) * move_sideways;
+    
+    float total_x = forward_x + strafe_x + player->reminder_x;
+    float total_y = forward_y + strafe_y + player->reminder_y;
+
+    int move_x = (int)round(total_x);
+    int move_y = (int)round(total_y);
+    
+      // Get current position
+    int current_x = player->x_pos;
+    int current_y = player->y_pos;
+    
+    // Calculate new positions
+    int new_x = current_x + move_x;
+    int new_y = current_y + move_y;
+    
+    // Separate X and Y collision checking for sliding along walls
+    int can_move_x = !square_collides(player, new_x, current_y);
+    int can_move_y = !square_collides(player, current_x, new_y);
+    
+    // Apply movement based on collision results
+    if (can_move_x)
+    {
+        player->x_pos = new_x;
+        player->reminder_x = total_x - move_x;
+    }
+    else
+        player->reminder_x = 0; // Reset reminder if we can't move
+    
+    if (can_move_y)
+    {
+        player->y_pos = new_y;
+        player->reminder_y = total_y - move_y;
+    }
+    else
+        player->reminder_y = 0; // Reset reminder if we can't move
+}
+
+t_pose player_pose(const t_player *player)
+{
+    return (t_pose){player->x_pos, player->y_pos, player->direction_angle};
+}
+
+// Pose a fraction t of the way from one pose to the next, turning the short
+// way round. Equal poses give back exactly the same pose.
+t_pose pose_lerp(const t_pose *from, const t_pose *to, double t)
+{
+    double turn = to->angle - from->angle;
+
+    if (turn > PI)
+        turn -= 2 * PI;
+    else if (turn < -PI)
+        turn += 2 * PI;
+    return (t_pose){
+        from->x + (to->x - from->x) * t,
+        from->y + (to->y - from->y) * t,
+        normalize_angle(from->angle + turn * t),
+    };
+}
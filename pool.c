@@ -0,0 +1,157 @@
+#include "cub3d.h"
+#include <unistd.h>
+
+typedef struct s_worker
+{
+    t_pool *pool;
+    int index;
+} t_worker;
+
+static void pool_range(t_pool *pool, int index, int *begin, int *end)
+{
+    long count = pool->count;
+
+    *begin = (int)(count * index / pool->n_threads);
+    *end = (int)(count * (index + 1) / pool->n_threads);
+}
+
+static void *pool_worker(void *param)
+{
+    t_worker *worker = (t_worker *)param;
+    t_pool *pool = worker->pool;
+    unsigned long seen = 0;
+    int begin, end;
+
+    while (1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stop && pool->generation == seen)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool_range(pool, worker->index, &begin, &end);
+        if (begin < end)
+            pool->fn(pool->ctx, begin, end);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    free(worker);
+    return NULL;
+}
+
+int pool_default_threads(void)
+{
+    char *env = getenv("CUB3D_THREADS");
+    long n;
+
+    if (env && *env)
+        n = strtol(env, NULL, 10);
+    else
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1)
+        n = 1;
+    if (n > 64)
+        n = 64;
+    return (int)n;
+}
+
+t_pool *pool_create(int n_threads)
+{
+    t_pool *pool = calloc(1, sizeof(t_pool));
+    if (!pool)
+        return NULL;
+    pool->n_threads = n_threads < 1 ? 1 : n_threads;
+    // A single-threaded pool never spawns anything: pool_run calls fn inline.
+    if (pool->n_threads == 1)
+        return pool;
+
+    pool->threads = calloc(pool->n_threads - 1, sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (int i = 1; i < pool->n_threads; i++) {
+        t_worker *worker = malloc(sizeof(t_worker));
+        if (worker) {
+            worker->pool = pool;
+            worker->index = i;
+        }
+        if (!worker || pthread_create(&pool->threads[i - 1], NULL, pool_worker, worker) != 0) {
+            free(worker);
+            // Run with whatever started; pool_range only hands out n_threads ranges.
+            pool->n_threads = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+void pool_run(t_pool *pool, t_pool_fn fn, void *ctx, int count)
+{
+    int begin, end;
+
+    if (pool->n_threads == 1) {
+        fn(ctx, 0, count);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->count = count;
+    pool->pending = pool->n_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    pool_range(pool, 0, &begin, &end);
+    if (begin < end)
+        fn(ctx, begin, end);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Index of the calling thread among the pool's n_threads, 0 for the one that
+// calls pool_run, so a fn can keep scratch space per thread
+int pool_thread(const t_pool *pool)
+{
+    pthread_t self = pthread_self();
+
+    for (int i = 0; i < pool->n_threads - 1; i++)
+        if (pthread_equal(pool->threads[i], self))
+            return i + 1;
+    return 0;
+}
+
+void pool_destroy(t_pool *pool)
+{
+    if (!pool)
+        return;
+    if (pool->threads) {
+        pthread_mutex_lock(&pool->lock);
+        pool->stop = 1;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+        for (int i = 0; i < pool->n_threads - 1; i++)
+            pthread_join(pool->threads[i], NULL);
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->start);
+        pthread_cond_destroy(&pool->done);
+        free(pool->threads);
+    }
+    free(pool);
+}
@@ -0,0 +1,140 @@
+#include "cub3d.h"
+
+// Direct writes into mlx_image_t pixels. A pixel is one 32-bit word, so fills
+// are plain word stores the compiler can vectorize, instead of a bounds
+// check and four byte stores per mlx_put_pixel call. Every writer
+// clips to the image itself.
+
+static inline uint32_t *raster_row(mlx_image_t *img, int y)
+{
+    return (uint32_t *)img->pixels + (size_t)y * img->width;
+}
+
+// Fills [x0, x1) of row y
+void raster_span(mlx_image_t *img, int x0, int x1, int y, uint32_t color)
+{
+    uint32_t word = raster_word(color);
+
+    if (y < 0 || y >= (int)img->height)
+        return;
+    x0 = x0 < 0 ? 0 : x0;
+    x1 = x1 > (int)img->width ? (int)img->width : x1;
+
+    uint32_t *row = raster_row(img, y);
+    for (int x = x0; x < x1; x++)
+        row[x] = word;
+}
+
+void raster_rect(mlx_image_t *img, int x, int y, int width, int height, uint32_t color)
+{
+    int y1 = y + height > (int)img->height ? (int)img->height : y + height;
+
+    for (y = y < 0 ? 0 : y; y < y1; y++)
+        raster_span(img, x, x + width, y, color);
+}
+
+// Zeroes the part of dirty inside the image and resets dirty to empty
+void raster_clear(mlx_image_t *img, t_rect *dirty)
+{
+    int x0 = dirty->x0 < 0 ? 0 : dirty->x0;
+    int x1 = dirty->x1 > (int)img->width ? (int)img->width : dirty->x1;
+
+    if (x0 < x1)
+        for (int y = dirty->y0 < 0 ? 0 : dirty->y0; y < dirty->y1 && y < (int)img->height; y++)
+            memset(raster_row(img, y) + x0, 0, (size_t)(x1 - x0) * sizeof(uint32_t));
+    *dirty = rect_empty();
+}
+
+// First major step k of a Bresenham line whose minor offset m_k is >= m.
+// With the error term below, m_k = ceil((2k * minor - major) / (2 * major)).
+static int64_t line_first_step(int64_t m, int64_t major, int64_t minor)
+{
+    if (m <= 0)
+        return 0;
+    if (m > minor)
+        return INT64_MAX;
+    return (__int128)(2 * m - 1) * major / (2 * minor) + 1;
+}
+
+// Last major step k whose minor offset m_k is <= m
+static int64_t line_last_step(int64_t m, int64_t major, int64_t minor)
+{
+    if (m < 0)
+        return -1;
+    if (m >= minor)
+        return INT64_MAX;
+    return (__int128)(2 * m + 1) * major / (2 * minor);
+}
+
+// Range [*lo, *hi] of offsets n along one axis that keep c0 + dir * n
+// inside [0, size).
+static void clip_offsets(int64_t c0, int dir, int64_t size, int64_t *lo, int64_t *hi)
+{
+    *lo = dir > 0 ? -c0 : c0 - (size - 1);
+    *hi = dir > 0 ? size - 1 - c0 : c0;
+}
+
+// Bresenham from (x0, y0) to (x1, y1), both ends included, drawing only the
+// pixels inside the image. The line is clipped once, Liang-Barsky style but in
+// whole steps along the major axis: the range of steps on screen comes from
+// the closed form of the minor offset, and the error term is rebuilt at the
+// first of them. The pixels are the same ones a per-pixel test would keep.
+void raster_line(mlx_image_t *img, int x0, int y0, int x1, int y1, uint32_t color)
+{
+    uint32_t word = raster_word(color);
+    int64_t dx = llabs((int64_t)x1 - x0);
+    int64_t dy = llabs((int64_t)y1 - y0);
+    int dir_x = x0 < x1 ? 1 : -1;
+    int dir_y = y0 < y1 ? 1 : -1;
+    int x_major = dx >= dy;
+    int64_t major = x_major ? dx : dy;
+    int64_t minor = x_major ? dy : dx;
+    int64_t first = 0;
+    int64_t last = major;
+    int64_t lo;
+    int64_t hi;
+
+    if (img->width == 0 || img->height == 0)
+        return;
+    // Major axis: the offset is the step itself
+    if (x_major)
+        clip_offsets(x0, dir_x, img->width, &lo, &hi);
+    else
+        clip_offsets(y0, dir_y, img->height, &lo, &hi);
+    first = lo > first ? lo : first;
+    last = hi < last ? hi : last;
+    // Minor axis: the offset never shrinks from one step to the next
+    if (x_major)
+        clip_offsets(y0, dir_y, img->height, &lo, &hi);
+    else
+        clip_offsets(x0, dir_x, img->width, &lo, &hi);
+    lo = line_first_step(lo, major, minor);
+    hi = line_last_step(hi, major, minor);
+    first = lo > first ? lo : first;
+    last = hi < last ? hi : last;
+    if (first > last)
+        return;
+
+    int64_t m = major == 0 ? 0 : ((__int128)2 * first * minor + major - 1) / (2 * major);
+    int64_t step_x = x_major ? first : m;
+    int64_t step_y = x_major ? m : first;
+    int64_t err = dx - dy - step_x * dy + step_y * dx;
+    ptrdiff_t row = dir_y > 0 ? (ptrdiff_t)img->width : -(ptrdiff_t)img->width;
+    uint32_t *pixel = raster_row(img, y0 + dir_y * step_y) + x0 + dir_x * step_x;
+
+    for (int64_t n = last - first; ; n--) {
+        int64_t e2 = 2 * err;
+
+        *pixel = word;
+        if (n == 0)
+            break;
+        if (e2 > -dy) {
+            err -= dy;
+            pixel += dir_x;
+        }
+        if (e2 < dx) {
+            err += dx;
+            pixel += row;
+        }
+    }
+}
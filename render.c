@@ -0,0 +1,353 @@
+#include "cub3d.h"
+
+// Shared by the column workers of one frame
+typedef struct s_view_job
+{
+    mlx_image_t *img;
+    const t_ray_batch *batch;
+    const t_texture *surfaces;
+    const t_texture *floor_tex;
+    const t_texture *ceiling_tex;
+    t_surface_fn span;
+    double origin_x;
+    double origin_y;
+    double ray0_x;
+    double ray0_y;
+    double ray_step_x;
+    double ray_step_y;
+    double focal;
+    uint32_t ceiling;
+    uint32_t floor;
+    int mipmap;
+    const t_sprites *sprites;
+    const double *zbuffer;
+    uint64_t *covered;
+    const t_pool *pool;
+    t_sprite_fn sprite_kernel;
+    uint32_t alpha_bit;
+} t_view_job;
+
+// Where one floor or ceiling row starts in its texture, and its step per pixel
+typedef struct s_surface_walk
+{
+    const t_mip *mip;
+    uint32_t u;
+    uint32_t v;
+    uint32_t du;
+    uint32_t dv;
+} t_surface_walk;
+
+// Mip level for a slice of the given height: the smallest one still at least
+// that tall, so a screen row steps less than two texels down its column and
+// far walls read a short run instead of striding across the full image
+static const t_mip *slice_mip(const t_view_job *job, const t_texture *tex, double slice)
+{
+    int level = 0;
+
+    while (job->mipmap && level + 1 < tex->level_count && tex->levels[level + 1].height >= slice)
+        level++;
+    return &tex->levels[level];
+}
+
+// Height in pixels of a slice one cell tall at the given depth, and the
+// screen rows [top, bottom) it covers, centred on the horizon. The height is
+// capped so a slice right at the eye still gets finite texture steps.
+static double slice_rows(const t_view_job *job, double depth, int *top, int *bottom)
+{
+    int height = job->img->height;
+    double slice = depth > 0 ? job->focal * TILE_SIZE / depth : 1e6;
+    double drawn;
+
+    slice = slice < 1e6 ? slice : 1e6;
+    drawn = slice < height ? slice : height;
+    *top = (int)((height - drawn) / 2);
+    *bottom = (int)((height + drawn) / 2);
+    return slice;
+}
+
+// The 16.16 fixed-point texel position at a slice's first drawn row, down
+// a column of tex, and the step per screen row
+static void slice_walk(const t_view_job *job, const t_mip *tex, double slice, int top, int rows,
+                       int *pos, int *step)
+{
+    double texels_per_row = tex->height / slice;
+    double slice_top = (job->img->height - slice) / 2;
+
+    double first = (top + 0.5 - slice_top) * texels_per_row;
+    double last = first + (rows - 1) * texels_per_row;
+
+    // Sample at pixel centres. A slice under a row tall can put those
+    // centres far outside it; clamp the walk to the column (the guard
+    // texels absorb the last half texel of rounding)
+    first = first < 0 ? 0 : first;
+    last = last > tex->height ? tex->height : last;
+    last = last < first ? first : last;
+    *pos = (int)(first * 65536);
+    *step = rows > 1 ? (int)((last - first) / (rows - 1) * 65536) : 0;
+}
+
+// Sets up one column's texture walk: the texel column its hit point falls
+// in and its walk down the slice. Returns the first texel of the column.
+static const uint32_t *column_setup(const t_view_job *job, int column, double slice,
+                                    int top, int rows, int *pos, int *step)
+{
+    int wall = job->batch->wall[column];
+    const t_mip *tex = slice_mip(job, &job->surfaces[wall], slice);
+    int tex_x = (int)(job->batch->u[column] * tex->width);
+
+    // With y pointing down, screen x runs against u on faces seen looking
+    // west or south; flip those so no face reads mirrored
+    if (wall == TEX_WE || wall == TEX_SO)
+        tex_x = tex->width - 1 - tex_x;
+    tex_x = tex_x < 0 ? 0 : tex_x >= tex->width ? tex->width - 1 : tex_x;
+
+    slice_walk(job, tex, slice, top, rows, pos, step);
+    return tex->texels + (size_t)tex_x * tex->stride + 1;
+}
+
+// 16.16 fixed point of a cell coordinate, wrapped to 32 bits
+static uint32_t cell_fixed(double cells)
+{
+    return (uint32_t)(int64_t)floor(cells * 65536);
+}
+
+// Texture walk of row y of a floor or ceiling from column x0 on. The row p
+// pixels off the horizon sees the surface focal / (2 * p) cells away, the eye
+// being half a cell up, and column x lands at origin + ray(x) times that,
+// with ray(x) the caster's ray for the column. The mip level keeps a pixel
+// under two texels wide both along the row and down to the next one.
+static t_surface_walk surface_walk(const t_view_job *job, const t_texture *tex, int y, int x0)
+{
+    double p = fabs(y + 0.5 - job->img->height / 2.0);
+    double cells = job->focal / (2 * (p > 0.5 ? p : 0.5));
+    double du = job->ray_step_x * cells;
+    double dv = job->ray_step_y * cells;
+    double along = sqrt(du * du + dv * dv);
+    double across = cells / (p > 0.5 ? p : 0.5);
+    double size = tex->levels[0].width > tex->levels[0].height ? tex->levels[0].width : tex->levels[0].height;
+    double footprint = (along > across ? along : across) * size;
+    int level = 0;
+
+    while (job->mipmap && level + 1 < tex->level_count && footprint >= 2) {
+        footprint /= 2;
+        level++;
+    }
+    return (t_surface_walk){
+        .mip = &tex->levels[level],
+        .u = cell_fixed(job->origin_x / TILE_SIZE + (job->ray0_x + x0 * job->ray_step_x) * cells),
+        .v = cell_fixed(job->origin_y / TILE_SIZE + (job->ray0_y + x0 * job->ray_step_y) * cells),
+        .du = cell_fixed(du),
+        .dv = cell_fixed(dv),
+    };
+}
+
+// Draws the part of one projected sprite that falls in the strip of
+// columns [x0, x1). Columns whose wall is nearer than the sprite stay as they
+// are, and so do pixels a nearer sprite already covered; the rest get the
+// sprite's texture column, skipping texels under half opaque. All columns
+// share one walk down the texture, so the kernel goes row by row and the
+// writes stay in the row like the walls'.
+static void draw_sprite(const t_view_job *job, int slot, int x0, int x1, uint64_t *covered)
+{
+    const t_sprites *sprites = job->sprites;
+    float depth = sprites->depth[slot];
+    int top;
+    int bottom;
+    double size = slice_rows(job, depth, &top, &bottom);
+    double left = sprites->screen_x[slot] - size / 2;
+    int first = (int)ceil(left - 0.5);
+    int last = (int)ceil(left + size - 0.5);
+    int32_t offsets[RENDER_STRIP];
+    uint64_t keep = 0;
+    int pos;
+    int step;
+
+    first = first > x0 ? first : x0;
+    last = last < x1 ? last : x1;
+    if (first >= last)
+        return;
+
+    const t_mip *tex = slice_mip(job, &job->surfaces[TEX_SPRITE], size);
+    for (int x = first; x < last; x++) {
+        int tex_x = (int)((x + 0.5 - left) / size * tex->width);
+
+        tex_x = tex_x < 0 ? 0 : tex_x >= tex->width ? tex->width - 1 : tex_x;
+        offsets[x - first] = tex_x * tex->stride + 1;
+        keep |= (uint64_t)(depth < job->zbuffer[x]) << (x - first);
+    }
+    if (!keep)
+        return;
+    for (int i = last - first; i % 8; i++)
+        offsets[i] = offsets[0];
+    slice_walk(job, tex, size, top, bottom - top, &pos, &step);
+    job->sprite_kernel(&(t_sprite_block){
+        .dst = (uint32_t *)job->img->pixels + (size_t)top * job->img->width + first,
+        .pitch = job->img->width,
+        .rows = bottom - top,
+        .n = last - first,
+        .texels = tex->texels,
+        .pos = pos,
+        .step = step,
+        .offsets = offsets,
+        .keep = keep,
+        .covered = covered + top,
+        .shift = first - x0,
+        .alpha_bit = job->alpha_bit,
+    });
+}
+
+// Fills strips [begin, end) of the view, RENDER_STRIP adjacent columns each.
+// A strip is one pass from the top row to the bottom one; per row its
+// columns are a short contiguous run, so every write lands in a cache line
+// the row before it already touched instead of one word per line per column.
+// Each column in turn reads its texture column straight down, which the
+// column-major layout keeps contiguous. A textured floor or ceiling row is
+// walked across the strip first and the wall slices drawn over it. Sprites
+// go last, nearest first, while the strip is still in cache.
+static void render_strips(void *ctx, int begin, int end)
+{
+    t_view_job *job = (t_view_job *)ctx;
+    int width = job->img->width;
+    int height = job->img->height;
+    int max_top;
+    int min_bottom;
+    int top[RENDER_STRIP];
+    int bottom[RENDER_STRIP];
+    int pos[RENDER_STRIP];
+    int step[RENDER_STRIP];
+    const uint32_t *texels[RENDER_STRIP];
+    // Sprite coverage of the current strip, one bit per column and row
+    uint64_t *covered = job->covered + (size_t)pool_thread(job->pool) * height;
+
+    for (int strip = begin; strip < end; strip++) {
+        int x0 = strip * RENDER_STRIP;
+        int n = width - x0 < RENDER_STRIP ? width - x0 : RENDER_STRIP;
+
+        max_top = 0;
+        min_bottom = height;
+        for (int c = 0; c < n; c++) {
+            double slice = slice_rows(job, job->batch->dist[x0 + c], &top[c], &bottom[c]);
+
+            texels[c] = column_setup(job, x0 + c, slice, top[c], bottom[c] - top[c], &pos[c], &step[c]);
+            max_top = top[c] > max_top ? top[c] : max_top;
+            min_bottom = bottom[c] < min_bottom ? bottom[c] : min_bottom;
+        }
+        for (int y = 0; y < height; y++) {
+            uint32_t *row = (uint32_t *)job->img->pixels + (size_t)y * width + x0;
+            const t_texture *surface = y < height / 2 ? job->ceiling_tex : job->floor_tex;
+
+            if (surface && (y < max_top || y >= min_bottom)) {
+                t_surface_walk walk = surface_walk(job, surface, y, x0);
+
+                job->span(row, n, walk.mip, walk.u, walk.v, walk.du, walk.dv);
+                for (int c = 0; c < n; c++)
+                    if (y >= top[c] && y < bottom[c]) {
+                        row[c] = texels[c][pos[c] >> 16];
+                        pos[c] += step[c];
+                    }
+                continue;
+            }
+            for (int c = 0; c < n; c++) {
+                if (y < top[c])
+                    row[c] = job->ceiling;
+                else if (y < bottom[c]) {
+                    row[c] = texels[c][pos[c] >> 16];
+                    pos[c] += step[c];
+                }
+                else
+                    row[c] = job->floor;
+            }
+        }
+        if (!job->sprites->visible)
+            continue;
+        memset(covered, 0, height * sizeof(uint64_t));
+        for (int i = 0; i < job->sprites->visible; i++)
+            draw_sprite(job, job->sprites->order[i], x0, x0 + n, covered);
+    }
+}
+
+// Projects the hit buffer into the first-person view: ceiling, textured wall
+// slice and floor for every column, split across the pool by strips. Floor
+// and ceiling are flat colors unless the scene gives them a texture. Sprites
+// are culled and sorted up front, then drawn strip by strip.
+static void render_view(t_player *player, const t_camera *camera)
+{
+    t_view_job job;
+    int strips = (player->view->width + RENDER_STRIP - 1) / RENDER_STRIP;
+
+    job.img = player->view;
+    job.batch = &player->caster.batch;
+    job.surfaces = player->scene.surfaces;
+    job.floor_tex = job.surfaces[TEX_FLOOR].level_count ? &job.surfaces[TEX_FLOOR] : NULL;
+    job.ceiling_tex = job.surfaces[TEX_CEILING].level_count ? &job.surfaces[TEX_CEILING] : NULL;
+    job.span = player->caster.span;
+    job.origin_x = player->caster.origin_x;
+    job.origin_y = player->caster.origin_y;
+    // Column rays of this frame's cast, so floor points line up with walls
+    job.ray0_x = player->caster.ray0_x;
+    job.ray0_y = player->caster.ray0_y;
+    job.ray_step_x = player->caster.ray_step_x;
+    job.ray_step_y = player->caster.ray_step_y;
+    // Distance from the eye to the screen in pixels: the camera plane spans
+    // the view width
+    job.focal = player->view->width / 2.0 / angle_tan(deg_to_radian(FOV) / 2);
+    job.ceiling = raster_word(player->scene.ceiling_color);
+    job.floor = raster_word(player->scene.floor_color);
+    job.mipmap = player->caster.mipmap;
+    job.sprites = &player->scene.sprites;
+    job.zbuffer = player->caster.zbuffer;
+    job.covered = player->caster.covered;
+    job.pool = player->caster.pool;
+    job.sprite_kernel = player->caster.sprite_kernel;
+    job.alpha_bit = raster_word(0x80);
+    sprites_project(&player->scene.sprites, camera, job.origin_x, job.origin_y, job.focal,
+                    player->view->width);
+    pool_run(player->caster.pool, render_strips, &job, strips);
+}
+
+static void draw_ray_fan(t_player *player, double player_x, double player_y)
+{
+    // Only last frame's fan needs wiping, not the whole overlay
+    raster_clear(player->direction_ray, &player->ray_dirty);
+    rect_include(&player->ray_dirty, (int)player_x, (int)player_y);
+    const t_caster *caster = &player->caster;
+
+    for (int i = 0; i < caster->count; i++) {
+        double dir_x = caster->ray0_x + i * caster->ray_step_x;
+        double dir_y = caster->ray0_y + i * caster->ray_step_y;
+
+        // Calculate end point (dir is not unit length, dist is along the view direction)
+        int end_x = (int)(player_x + dir_x * caster->batch.dist[i]);
+        int end_y = (int)(player_y + dir_y * caster->batch.dist[i]);
+
+        // Choose color based on ray (center ray red, others yellow)
+        int color = 0xFF0000FF;
+
+        // Draw the ray
+        raster_line(player->direction_ray,
+                    (int)player_x, (int)player_y,
+                    end_x, end_y, color);
+        rect_include(&player->ray_dirty, end_x, end_y);
+    }
+}
+
+// Casts one ray per view column from pose, then draws the first-person view
+// and, while the minimap is shown, the ray fan over it. The caster must have
+// been reserved for the view (caster_reserve).
+void render_frame(t_player *player, const t_pose *pose)
+{
+    double player_x = pose->x + player->size / 2.0;
+    double player_y = pose->y + player->size / 2.0;
+
+    int num_rays = player->view->width;
+    t_camera camera;
+    camera_from_angle(&camera, pose->angle, deg_to_radian(FOV));
+
+    // Cast every column in one batch, then draw from the hit buffer
+    caster_cast(&player->caster, &player->scene.grid, player_x, player_y, &camera, num_rays);
+    if (player->caster.count != num_rays)
+        return;
+    render_view(player, &camera);
+    if (player->direction_ray->enabled)
+        draw_ray_fan(player, player_x, player_y);
+}
@@ -0,0 +1,204 @@
+#include "cub3d.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define SPRITE_HAVE_AVX2 1
+#endif
+
+// Sprites closer than this to the eye plane are dropped rather than blown
+// up to fill the view
+#define SPRITE_NEAR 1.0
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// All the arrays are 4 bytes per sprite and share one block, owned by x.
+// Only x and y carry over when it grows; the rest is per-frame scratch.
+static int sprites_reserve(t_sprites *sprites, int count)
+{
+    if (count <= sprites->capacity)
+        return 0;
+    int capacity = sprites->capacity ? sprites->capacity * 2 : 64;
+    capacity = capacity < count ? count : capacity;
+
+    float *block = malloc((size_t)capacity * 8 * sizeof(float));
+    if (!block)
+        return -1;
+    if (sprites->count) {
+        memcpy(block, sprites->x, (size_t)sprites->count * sizeof(float));
+        memcpy(block + capacity, sprites->y, (size_t)sprites->count * sizeof(float));
+    }
+    free(sprites->x);
+    sprites->x = block;
+    sprites->y = block + capacity;
+    sprites->depth = block + (size_t)capacity * 2;
+    sprites->screen_x = block + (size_t)capacity * 3;
+    sprites->index = (uint32_t *)(block + (size_t)capacity * 4);
+    sprites->order = (uint32_t *)(block + (size_t)capacity * 5);
+    sprites->keys = (uint32_t *)(block + (size_t)capacity * 6);
+    sprites->scratch = (uint32_t *)(block + (size_t)capacity * 7);
+    sprites->capacity = capacity;
+    return 0;
+}
+
+int sprites_add(t_sprites *sprites, float x, float y)
+{
+    if (sprites_reserve(sprites, sprites->count + 1) != 0)
+        return -1;
+    sprites->x[sprites->count] = x;
+    sprites->y[sprites->count] = y;
+    sprites->count++;
+    return 0;
+}
+
+// Sorts slots [0, n) by keys into order, least first: LSD radix sort over
+// 8-bit digits, ping-ponging between order and scratch. Digits that are the
+// same for every key (the top ones, for depths of one scene) cost no pass.
+static void radix_sort(const uint32_t *keys, uint32_t *order, uint32_t *scratch, int n)
+{
+    uint32_t counts[32 / RADIX_BITS][RADIX_BUCKETS];
+    uint32_t *src = order;
+    uint32_t *dst = scratch;
+
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+        for (int d = 0; d < 32 / RADIX_BITS; d++)
+            counts[d][keys[i] >> (d * RADIX_BITS) & (RADIX_BUCKETS - 1)]++;
+    }
+    for (int d = 0; d < 32 / RADIX_BITS; d++) {
+        int shift = d * RADIX_BITS;
+        uint32_t offset = 0;
+
+        if (n == 0 || counts[d][keys[0] >> shift & (RADIX_BUCKETS - 1)] == (uint32_t)n)
+            continue;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            uint32_t count = counts[d][b];
+
+            counts[d][b] = offset;
+            offset += count;
+        }
+        for (int i = 0; i < n; i++)
+            dst[counts[d][keys[src[i]] >> shift & (RADIX_BUCKETS - 1)]++] = src[i];
+
+        uint32_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != order)
+        memcpy(order, src, (size_t)n * sizeof(uint32_t));
+}
+
+// Culls the sprites against the view and sorts the ones left by depth.
+// depth is the distance along the view direction, like a wall hit's, and
+// screen_x the column the sprite's centre projects to. Positive floats order
+// like their bit patterns, so the depths themselves are the sort keys.
+void sprites_project(t_sprites *sprites, const t_camera *camera, double origin_x, double origin_y,
+                     double focal, int width)
+{
+    double plane = sqrt(camera->plane_x * camera->plane_x + camera->plane_y * camera->plane_y);
+    double right_x = camera->plane_x / plane;
+    double right_y = camera->plane_y / plane;
+    int visible = 0;
+
+    for (int i = 0; i < sprites->count; i++) {
+        double rel_x = sprites->x[i] - origin_x;
+        double rel_y = sprites->y[i] - origin_y;
+        double depth = rel_x * camera->dir_x + rel_y * camera->dir_y;
+
+        if (depth < SPRITE_NEAR)
+            continue;
+        double screen_x = width / 2.0 + focal * (rel_x * right_x + rel_y * right_y) / depth;
+        double half = focal * TILE_SIZE / depth / 2;
+
+        if (screen_x + half < 0 || screen_x - half > width)
+            continue;
+        sprites->depth[visible] = depth;
+        sprites->screen_x[visible] = screen_x;
+        sprites->index[visible] = i;
+        memcpy(&sprites->keys[visible], &sprites->depth[visible], sizeof(uint32_t));
+        visible++;
+    }
+    sprites->visible = visible;
+    radix_sort(sprites->keys, sprites->order, sprites->scratch, visible);
+}
+
+static void sprite_block_scalar(const t_sprite_block *block)
+{
+    uint32_t *dst = block->dst;
+    int pos = block->pos;
+
+    for (int row = 0; row < block->rows; row++, dst += block->pitch, pos += block->step) {
+        const uint32_t *texels = block->texels + (pos >> 16);
+        uint64_t open = block->keep & ~(block->covered[row] >> block->shift);
+        uint64_t drawn = 0;
+
+        for (; open; open &= open - 1) {
+            int i = __builtin_ctzll(open);
+            uint32_t texel = texels[block->offsets[i]];
+
+            if (texel & block->alpha_bit) {
+                dst[i] = texel;
+                drawn |= 1ULL << i;
+            }
+        }
+        block->covered[row] |= drawn << block->shift;
+    }
+}
+
+#ifdef SPRITE_HAVE_AVX2
+
+// Eight pixels per step: one gather of their texels, then a masked store of
+// the open, opaque ones. Steps with no open pixel skip the gather.
+__attribute__((target("avx2")))
+static void sprite_block_avx2(const t_sprite_block *block)
+{
+    const __m256i bit = _mm256_set1_epi32(block->alpha_bit);
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    uint32_t *dst = block->dst;
+    int pos = block->pos;
+
+    for (int row = 0; row < block->rows; row++, dst += block->pitch, pos += block->step) {
+        const int *texels = (const int *)block->texels + (pos >> 16);
+        uint64_t open = block->keep & ~(block->covered[row] >> block->shift);
+        uint64_t drawn = 0;
+
+        for (int i = 0; i < block->n && open >> i; i += 8) {
+            __m256i lanes = _mm256_and_si256(_mm256_set1_epi32((open >> i) & 0xFF), lane_bits);
+
+            if (((open >> i) & 0xFF) == 0)
+                continue;
+            __m256i offsets = _mm256_loadu_si256((const __m256i *)(block->offsets + i));
+            __m256i texel = _mm256_i32gather_epi32(texels, offsets, 4);
+            __m256i clear = _mm256_cmpeq_epi32(_mm256_and_si256(texel, bit), _mm256_setzero_si256());
+            __m256i mask = _mm256_andnot_si256(clear, _mm256_cmpeq_epi32(lanes, lane_bits));
+
+            _mm256_maskstore_epi32((int *)(dst + i), mask, texel);
+            drawn |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(mask)) << i;
+        }
+        block->covered[row] |= drawn << block->shift;
+    }
+}
+
+#endif
+
+// Picks the widest sprite kernel this CPU runs; CUB3D_SIMD=0 forces the
+// scalar loop. Both write the same pixels.
+t_sprite_fn sprite_select_kernel(void)
+{
+    char *simd = getenv("CUB3D_SIMD");
+
+    if (simd && *simd == '0')
+        return sprite_block_scalar;
+#ifdef SPRITE_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return sprite_block_avx2;
+#endif
+    return sprite_block_scalar;
+}
+
+void sprites_destroy(t_sprites *sprites)
+{
+    free(sprites->x);
+    memset(sprites, 0, sizeof(t_sprites));
+}
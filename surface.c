@@ -0,0 +1,80 @@
+#include "cub3d.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define SURFACE_HAVE_AVX2 1
+#endif
+
+// Floor and ceiling spans. A screen row sees the floor (or ceiling) at one
+// distance, so the world point under each of its pixels moves by the same
+// step from column to column: the row walks u, v linearly. u and v are cell
+// coordinates in 16.16 fixed point; only their fraction picks the texel, so
+// the integer part may wrap freely.
+
+static inline uint32_t span_texel(const t_mip *mip, uint32_t u, uint32_t v)
+{
+    uint32_t x = (u & 0xFFFF) * mip->width >> 16;
+    uint32_t y = (v & 0xFFFF) * mip->height >> 16;
+
+    return mip->texels[x * mip->stride + y + 1];
+}
+
+static void surface_span_scalar(uint32_t *dst, int n, const t_mip *mip,
+                                uint32_t u, uint32_t v, uint32_t du, uint32_t dv)
+{
+    for (int i = 0; i < n; i++) {
+        dst[i] = span_texel(mip, u, v);
+        u += du;
+        v += dv;
+    }
+}
+
+#ifdef SURFACE_HAVE_AVX2
+
+// Eight pixels per step: the texel offsets are worked out in 32-bit lanes
+// and the texels fetched with one gather, then stored straight into the row
+__attribute__((target("avx2")))
+static void surface_span_avx2(uint32_t *dst, int n, const t_mip *mip,
+                              uint32_t u, uint32_t v, uint32_t du, uint32_t dv)
+{
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i fraction = _mm256_set1_epi32(0xFFFF);
+    const __m256i width = _mm256_set1_epi32(mip->width);
+    const __m256i height = _mm256_set1_epi32(mip->height);
+    const __m256i stride = _mm256_set1_epi32(mip->stride);
+    const __m256i step_u = _mm256_set1_epi32(du * 8);
+    const __m256i step_v = _mm256_set1_epi32(dv * 8);
+    const int *base = (const int *)(mip->texels + 1);
+    __m256i vu = _mm256_add_epi32(_mm256_set1_epi32(u), _mm256_mullo_epi32(lane, _mm256_set1_epi32(du)));
+    __m256i vv = _mm256_add_epi32(_mm256_set1_epi32(v), _mm256_mullo_epi32(lane, _mm256_set1_epi32(dv)));
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_and_si256(vu, fraction), width), 16);
+        __m256i y = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_and_si256(vv, fraction), height), 16);
+        __m256i offset = _mm256_add_epi32(_mm256_mullo_epi32(x, stride), y);
+
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_i32gather_epi32(base, offset, 4));
+        vu = _mm256_add_epi32(vu, step_u);
+        vv = _mm256_add_epi32(vv, step_v);
+    }
+    surface_span_scalar(dst + i, n - i, mip, u + i * du, v + i * dv, du, dv);
+}
+
+#endif
+
+// Picks the widest span kernel this CPU runs; CUB3D_SIMD=0 forces the scalar
+// loop, like it does for ray packets. Both write the same texels.
+t_surface_fn surface_select_span(void)
+{
+    char *simd = getenv("CUB3D_SIMD");
+
+    if (simd && *simd == '0')
+        return surface_span_scalar;
+#ifdef SURFACE_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return surface_span_avx2;
+#endif
+    return surface_span_scalar;
+}
@@ -0,0 +1,118 @@
+#include "cub3d.h"
+
+// Column-major wall textures with mip chains. Nothing here calls into MLX,
+// so tools built without a window (bench) can make textures too.
+
+// Lays out every level of a width x height chain in one block
+static int texture_alloc(t_texture *tex, int width, int height)
+{
+    size_t words = 0;
+
+    memset(tex, 0, sizeof(t_texture));
+    for (int level = 0; level < TEXTURE_MAX_LEVELS; level++) {
+        t_mip *mip = &tex->levels[level];
+
+        mip->width = width;
+        mip->height = height;
+        mip->stride = height + 2;
+        words += (size_t)width * mip->stride;
+        tex->level_count = level + 1;
+        if (width == 1 && height == 1)
+            break;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    uint32_t *texels = malloc(words * sizeof(uint32_t));
+    if (!texels)
+        return -1;
+    for (int level = 0; level < tex->level_count; level++) {
+        tex->levels[level].texels = texels;
+        texels += (size_t)tex->levels[level].width * tex->levels[level].stride;
+    }
+    return 0;
+}
+
+// Copies each column's end texels into its guard slots
+static void mip_guard(t_mip *mip)
+{
+    for (int x = 0; x < mip->width; x++) {
+        uint32_t *column = mip->texels + (size_t)x * mip->stride;
+
+        column[0] = column[1];
+        column[mip->height + 1] = column[mip->height];
+    }
+}
+
+// Rounded mean of four pixel words, per byte: two channels at a time in
+// 16-bit lanes, which four bytes plus rounding cannot overflow
+static uint32_t average4(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    const uint32_t mask = 0x00FF00FF;
+    uint32_t even = (a & mask) + (b & mask) + (c & mask) + (d & mask) + 0x00020002;
+    uint32_t odd = (a >> 8 & mask) + (b >> 8 & mask) + (c >> 8 & mask) + (d >> 8 & mask) + 0x00020002;
+
+    return (even >> 2 & mask) | (odd >> 2 & mask) << 8;
+}
+
+// Box-filters src into dst, half its size; a source side of 1 is reused
+static void mip_downsample(const t_mip *src, t_mip *dst)
+{
+    for (int x = 0; x < dst->width; x++) {
+        const uint32_t *left = src->texels + (size_t)(2 * x) * src->stride + 1;
+        const uint32_t *right = src->width > 1 ? left + src->stride : left;
+        uint32_t *column = dst->texels + (size_t)x * dst->stride + 1;
+
+        for (int y = 0; y < dst->height; y++) {
+            int y0 = src->height > 1 ? 2 * y : 0;
+            int y1 = src->height > 1 ? 2 * y + 1 : 0;
+
+            column[y] = average4(left[y0], left[y1], right[y0], right[y1]);
+        }
+    }
+    mip_guard(dst);
+}
+
+// Fills the guards of level 0 and derives every other level from it
+static void texture_build_mips(t_texture *tex)
+{
+    mip_guard(&tex->levels[0]);
+    for (int level = 1; level < tex->level_count; level++)
+        mip_downsample(&tex->levels[level - 1], &tex->levels[level]);
+}
+
+// A 1x1 texture of one color, so faces without an image take the same
+// sampling path as textured ones
+int texture_flat(t_texture *tex, uint32_t color)
+{
+    if (texture_alloc(tex, 1, 1) != 0)
+        return -1;
+    tex->levels[0].texels[1] = raster_word(color);
+    texture_build_mips(tex);
+    return 0;
+}
+
+// Builds a texture from row-major RGBA bytes (image pixel layout), transposed
+// into column-major order: every texel copies over as one word. The mip
+// chain is built right after.
+int texture_from_rgba(t_texture *tex, const uint8_t *rgba, int width, int height)
+{
+    if (width <= 0 || height <= 0 || width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE
+        || texture_alloc(tex, width, height) != 0)
+        return -1;
+
+    t_mip *base = &tex->levels[0];
+    for (int y = 0; y < height; y++) {
+        const uint8_t *src = rgba + (size_t)y * width * 4;
+
+        for (int x = 0; x < width; x++)
+            memcpy(base->texels + (size_t)x * base->stride + y + 1, src + x * 4, sizeof(uint32_t));
+    }
+    texture_build_mips(tex);
+    return 0;
+}
+
+void texture_destroy(t_texture *tex)
+{
+    free(tex->levels[0].texels);
+    memset(tex, 0, sizeof(t_texture));
+}
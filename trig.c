@@ -0,0 +1,16 @@
+#include "cub3d.h"
+
+double g_angle_sin[ANGLE_QUARTER + 1];
+double g_angle_tan[ANGLE_QUARTER + 1];
+
+// Runs before main, so the tables are there for anything linked with this
+// file without an init call to forget. tan at the quarter turn is libm's
+// huge finite value, like tan(PI / 2).
+__attribute__((constructor))
+static void angle_tables_init(void)
+{
+    for (int i = 0; i <= ANGLE_QUARTER; i++) {
+        g_angle_sin[i] = sin(angle_to_radians(i));
+        g_angle_tan[i] = tan(angle_to_radians(i));
+    }
+}